@@ -24,7 +24,11 @@ module Assertions(VerifyProgramArgs: VERIFY_PROGRAM_ARGS) = struct
 
   let lemma_rules = ref []
 
+  (** Incremented whenever an automation rule is added; invalidates the rule index. *)
+  let rules_generation = ref 0
+
   let add_lemma_rule symb rule = 
+    incr rules_generation;
     (begin match try_assq symb !lemma_rules with
       None -> lemma_rules := (symb, ref [rule]) :: !lemma_rules
     | Some(rs) -> rs := rule :: !rs end)
@@ -60,7 +64,7 @@ module Assertions(VerifyProgramArgs: VERIFY_PROGRAM_ARGS) = struct
     let oldForest = !currentForest in
     let leftForest = ref [] in
     let rightForest = ref [] in
-    oldForest := Node (BranchNode, rightForest)::Node (BranchNode, leftForest)::!oldForest;
+    if not !Tracelog.tracing then oldForest := Node (BranchNode, rightForest)::Node (BranchNode, leftForest)::!oldForest;
     currentForest := leftForest;
     push_context (Branching LeftBranch);
     execute_branch cont1;
@@ -116,6 +120,39 @@ module Assertions(VerifyProgramArgs: VERIFY_PROGRAM_ARGS) = struct
     (* print_endline ("Checking definite equality of " ^ ctxt#pprint t1 ^ " and " ^ ctxt#pprint t2 ^ ": " ^ (if result then "true" else "false")); *)
     result
   
+  (* Array writes build update(i, v, vs) terms. To read an element back, the update terms written since the array
+     chunk was produced are walked from the most recent one: a write at the same index yields the written value
+     directly, and a write at a provably different index is skipped, so that the prover need not reason about
+     nth(i, update(j, v, vs)). Only when neither holds is an nth term built, on the innermost list reached. *)
+
+  (** Maps the update terms built by mk_array_update to their index, their element value (of the given prover type, before boxing) and the list they update. *)
+  let array_updates: (termnode * (termnode * prover_type) * termnode) TermHashtbl.t = TermHashtbl.create 1000
+
+  let max_array_update_walk = 16
+
+  let mk_array_update elem_tp i v vs =
+    let (_, _, _, _, update_symb) = List.assoc "update" purefuncmap in
+    let elem_provertype = provertype_of_type elem_tp in
+    let updated = mk_app update_symb [i; apply_conversion elem_provertype ProverInductive v; vs] in
+    if TermHashtbl.length array_updates > 100000 then TermHashtbl.reset array_updates;
+    TermHashtbl.replace array_updates updated (i, (v, elem_provertype), vs);
+    updated
+
+  (** Like mk_nth, for the contents of an array chunk; [i] must be within the bounds of the chunk. *)
+  let mk_array_nth elem_tp i vs =
+    let rec iter depth vs =
+      match TermHashtbl.find_opt array_updates vs with
+        Some (j, (v, v_provertype), vs0) ->
+        if definitely_equal i j then
+          if v_provertype = provertype_of_type elem_tp then v else mk_nth elem_tp i vs
+        else if depth < max_array_update_walk && query_term (ctxt#mk_not (ctxt#mk_eq i j)) then
+          iter (depth + 1) vs0
+        else
+          mk_nth elem_tp i vs
+      | None -> mk_nth elem_tp i vs
+    in
+    iter 0 vs
+
   let predname_eq g1 g2 =
     match (g1, g2) with
       ((g1, literal1), (g2, literal2)) -> if literal1 && literal2 then g1 == g2 else definitely_equal g1 g2
@@ -168,6 +205,9 @@ module Assertions(VerifyProgramArgs: VERIFY_PROGRAM_ARGS) = struct
     if inputParamCount = None || coef == real_unit then
       cont (Chunk (g_symb, targs, coef, ts, size)::h)
     else
+      let outer = current_alloc_subsystem () in
+      with_alloc_subsystem AllocHeapChunks @@ fun () ->
+      let cont = if !alloc_attribution then (fun h -> with_alloc_subsystem outer (fun () -> cont h)) else cont in
       let Some n = inputParamCount in
       let rec iter hdone htodo =
         match htodo with
@@ -229,7 +269,7 @@ module Assertions(VerifyProgramArgs: VERIFY_PROGRAM_ARGS) = struct
       match p with
         Sep (_, _, _) -> cont()
       | _ ->
-        with_context ~verbosity_level:2 (Executing (h, env, asn_loc p, "Producing assertion")) cont
+        in_context ~verbosity_level:2 (Executing (h, env, asn_loc p, "Producing assertion")) cont
     in
     with_context_helper (fun _ ->
     let ev = eval None env in
@@ -538,6 +578,7 @@ module Assertions(VerifyProgramArgs: VERIFY_PROGRAM_ARGS) = struct
           newChunks -- Any new chunks generated by this match; in particular, auto-splitting of fractional permissions.
    *)
   let match_chunk ghostenv h env env' l g targs coef coefpat inputParamCount pats tps0 tps (Chunk (g', targs0, coef0, ts0, size0) as chunk) cont =
+    profile_chunk_match ();
     let match_coef ghostenv env cont =
       if coef == real_unit && coefpat == real_unit_pat && coef0 == real_unit then cont chunk ghostenv env coef0 [] else
       let match_term_coefpat t =
@@ -630,7 +671,7 @@ module Assertions(VerifyProgramArgs: VERIFY_PROGRAM_ARGS) = struct
           [v]
       | Chunk ((g, true), [tp], coef, [a'; istart; iend; vs], _)
           when g == array_slice_symb() && definitely_equal a' a && ctxt#query (ctxt#mk_and (ctxt#mk_le istart i) (ctxt#mk_lt i iend)) ->
-          [mk_nth tp (ctxt#mk_sub i istart) vs]
+          [mk_array_nth tp (ctxt#mk_sub i istart) vs]
      (* | Chunk ((g, true), [tp;tp2;tp3], coef, [a'; istart; iend; p; info; elems; vs], _)
           when g == array_slice_deep_symb() && definitely_equal a' a && ctxt#query (ctxt#mk_and (ctxt#mk_le istart i) (ctxt#mk_lt i iend)) ->
           let (_, _, _, _, nth_symb) = List.assoc "nth" purefuncmap in
@@ -648,9 +689,7 @@ module Assertions(VerifyProgramArgs: VERIFY_PROGRAM_ARGS) = struct
         Some(seen @ ((Chunk ((g, true), [tp], coef, [a'; i'; new_value], b)) :: rest))
       | Chunk ((g, true), [tp], coef, [a'; istart; iend; vs], b) :: rest
           when g == array_slice_symb() && definitely_equal a' a && ctxt#query (ctxt#mk_and (ctxt#mk_le istart i) (ctxt#mk_lt i iend)) && definitely_equal coef real_unit ->
-        let (_, _, _, _, update_symb) = List.assoc "update" purefuncmap in
-        let converted_new_value = apply_conversion (provertype_of_type tp) ProverInductive new_value in
-        let updated_vs = (mk_app update_symb [ctxt#mk_sub i istart; converted_new_value; vs]) in
+        let updated_vs = mk_array_update tp (ctxt#mk_sub i istart) new_value vs in
         Some(seen @ ((Chunk ((g, true), [tp], coef, [a'; istart; iend; updated_vs], b)) :: rest))
       | chunk :: rest ->
         try_update_java_array_core rest (seen @ [chunk])
@@ -687,7 +726,7 @@ module Assertions(VerifyProgramArgs: VERIFY_PROGRAM_ARGS) = struct
               definitely_equal size' size &&
               definitely_equal signed' signed &&
               ctxt#query (ctxt#mk_and (ctxt#mk_le (ctxt#mk_intlit 0) i) (ctxt#mk_lt i n')) ->
-            [mk_nth tp i vs']
+            [mk_array_nth tp i vs']
         | _ -> []
         end
         h
@@ -719,7 +758,7 @@ module Assertions(VerifyProgramArgs: VERIFY_PROGRAM_ARGS) = struct
               predname_eq g (array_predsym, true) &&
               definitely_equal a' a &&
               ctxt#query (ctxt#mk_and (ctxt#mk_le (ctxt#mk_intlit 0) i) (ctxt#mk_lt i n')) ->
-            [mk_nth tp i vs']
+            [mk_array_nth tp i vs']
         | _ -> []
         end
         h
@@ -758,6 +797,33 @@ module Assertions(VerifyProgramArgs: VERIFY_PROGRAM_ARGS) = struct
   
   let consume_chunk_recursion_depth = ref 0
   
+  (* The automation rules of each predicate symbol, in the order in which consume_chunk_core tries them, each with its
+     most recent failures. A rule that failed on a heap, coefficient and arguments fails again on the same (physically
+     equal) inputs as long as nothing has been assumed since, so consume_chunk_core skips such attempts. The recursion
+     depth is part of the key: a rule tried closer to the depth cutoff may give up where a shallower attempt succeeds. *)
+  let rule_index = TermHashtbl.create 100
+  let ctor_rule_index = TermHashtbl.create 100 (* Open/close rules only; used for predicate constructor applications *)
+  let rule_index_rules = ref [] (* The rule map the index was built from *)
+  let rule_index_generation = ref (-1)
+  let max_rule_failures = 16
+  
+  let indexed_rules rules ~include_lemma_rules g =
+    if !rules != !rule_index_rules || !rules_generation <> !rule_index_generation then begin
+      TermHashtbl.reset rule_index;
+      TermHashtbl.reset ctor_rule_index;
+      rule_index_rules := !rules;
+      rule_index_generation := !rules_generation
+    end;
+    let index = if include_lemma_rules then rule_index else ctor_rule_index in
+    match TermHashtbl.find_opt index g with
+      Some entry -> entry
+    | None ->
+      let open_close_rules = match try_assq g !rules with None -> [] | Some rules -> !rules in
+      let lemma_rules = if include_lemma_rules then match try_assq g !lemma_rules with None -> [] | Some rules -> !rules else [] in
+      let entry = List.map (fun rule -> (rule, ref [])) (open_close_rules @ lemma_rules) in
+      TermHashtbl.add index g entry;
+      entry
+  
   (** consume_chunk_core attempts to consume a chunk matching the specified predicate assertion from the specified heap.
       If no matching chunk is found in the heap, automation rules are tried (e.g. auto-open and auto-close rules).
       Parameters:
@@ -789,6 +855,12 @@ module Assertions(VerifyProgramArgs: VERIFY_PROGRAM_ARGS) = struct
             env': (string * term) list -- Updated list of bindings of declared but unbound variables
     *)
   let consume_chunk_core rules h ghostenv env env' l g targs coef coefpat inputParamCount pats tps0 tps cont =
+    let outer = current_alloc_subsystem () in
+    with_alloc_subsystem AllocHeapChunks @@ fun () ->
+    let cont =
+      if not !alloc_attribution then cont else
+      fun chunk h coef ts size ghostenv env env' -> with_alloc_subsystem outer (fun () -> cont chunk h coef ts size ghostenv env env')
+    in
     let old_depth = !consume_chunk_recursion_depth in
     let rec consume_chunk_core_core h =
       begin fun cont ->
@@ -848,25 +920,38 @@ module Assertions(VerifyProgramArgs: VERIFY_PROGRAM_ARGS) = struct
                 let coefpat = match coefpat with SrcPat (LitPat e) -> TermPat (eval None env e) | _ -> coefpat in 
                 match rules with
                  [] -> cont ()
-                | rule::rules ->
-                  rule l h targs terms_are_well_typed coef coefpat ts $. fun h ->
-                  match h with
-                    None -> iter rules
+                | (rule, failures)::rules ->
+                  let generation = !assume_generation in
+                  let depth = !consume_chunk_recursion_depth in
+                  let same_failure (h', targs', coef', coefpat', ts', generation', depth') =
+                    generation' = generation && depth' = depth && h' == h && targs' == targs && coef' == coef && coefpat' == coefpat && List.length ts' = List.length ts && List.for_all2 (==) ts' ts
+                  in
+                  if List.exists same_failure !failures then begin
+                    !stats#ruleFailureCached;
+                    iter rules
+                  end else begin
+                  !stats#ruleAttempt;
+                  rule l h targs terms_are_well_typed coef coefpat ts $. fun h' ->
+                  match h' with
+                    None ->
+                    if !assume_generation = generation then
+                      failures := (h, targs, coef, coefpat, ts, generation, depth)::(if List.length !failures < max_rule_failures then !failures else take (max_rule_failures - 1) !failures);
+                    iter rules
                   | Some h ->
+                    !stats#ruleHit;
                     with_context (Executing (h, env, l, "Consuming chunk (retry)")) $. fun () ->
                     consume_chunk_core_core h
+                  end
               in
                 iter rules
             in
-            let open_close_rules = match try_assq g ! rules with None -> [] | Some(rules) -> !rules in
-            let lemma_rules = match try_assq g !lemma_rules with None -> [] | Some(rules) -> !rules in
-            begin match open_close_rules @ lemma_rules with
+            begin match indexed_rules rules ~include_lemma_rules:true g with
               [] ->  begin match try_assq g ! pred_ctor_applications with 
                   None -> cont ()
                 | Some (_, symbol_term, ctor_args, _) -> 
-                  begin match try_assq symbol_term ! rules with
-                    Some rules -> try_rules !rules (ctor_args @ ts)
-                  | None -> cont ()
+                  begin match indexed_rules rules ~include_lemma_rules:false symbol_term with
+                    [] -> cont ()
+                  | rules -> try_rules rules (ctor_args @ ts)
                   end
               end
             | rules -> try_rules rules ts
@@ -949,7 +1034,7 @@ module Assertions(VerifyProgramArgs: VERIFY_PROGRAM_ARGS) = struct
       match p with
         Sep (_, _, _) -> cont()
       | _ ->
-        with_context ~verbosity_level:2 (Executing (h, env, asn_loc p, "Consuming assertion")) cont
+        in_context ~verbosity_level:2 (Executing (h, env, asn_loc p, "Consuming assertion")) cont
     in
     with_context_helper (fun _ ->
     let ev = eval None env in
@@ -1468,7 +1553,7 @@ module Assertions(VerifyProgramArgs: VERIFY_PROGRAM_ARGS) = struct
                              let Some tpenv = zip predinst_tparams current_targs in
                              let env = List.map2 (fun (x, tp0) actual -> let tp = instantiate_type tpenv tp0 in (x, prover_convert_term actual tp tp0)) (take inputParamCount xs) current_input_args in 
                              let env = match current_this_opt with None -> env | Some t -> ("this", t) :: env in
-                             List.exists (fun conds -> (for_all_rev (fun cond -> ctxt#query (eval None env cond)) conds)) conds
+                             List.exists (fun conds -> (ctxt#query_all (List.rev_map (fun cond () -> eval None env cond) conds))) conds
                            )
                          )
                         empty_preds 
@@ -1486,7 +1571,7 @@ module Assertions(VerifyProgramArgs: VERIFY_PROGRAM_ARGS) = struct
                 None -> env
               | Some t ->  ("this", t) :: env
               in
-              if (for_all_rev (fun cond -> ctxt#query (eval None env cond)) conds) then
+              if (ctxt#query_all (List.rev_map (fun cond () -> eval None env cond) conds)) then
                 let env = List.map2 (fun (x, tp0) actual -> (x, actual)) outer_formal_input_args current_input_args in
                 let env = match current_this_opt with
                   None -> env
@@ -1610,7 +1695,7 @@ module Assertions(VerifyProgramArgs: VERIFY_PROGRAM_ARGS) = struct
                   None -> env
                 | Some t -> ("this", t) :: env
               in
-              if (for_all_rev (fun cond -> ctxt#query (eval None env cond)) conds) then
+              if (ctxt#query_all (List.rev_map (fun cond () -> eval None env cond) conds)) then
                 let env = List.map2 (fun (x, tp0) actual -> (x, actual)) outer_formal_input_args actual_input_args in
                 let env = match actual_this_opt with
                   None -> env
@@ -1744,7 +1829,7 @@ module Assertions(VerifyProgramArgs: VERIFY_PROGRAM_ARGS) = struct
             List.for_all2 definitely_equal indices fsymbs &&
             let Some tpenv = zip predinst_tparams targs in
             let env = List.map2 (fun (x, tp0) t -> let tp = instantiate_type tpenv tp0 in (x, prover_convert_term t tp tp0)) inputParams inputArgs in
-            List.exists (fun conds -> for_all_rev (fun cond -> ctxt#query (eval None env cond)) conds) conds
+            List.exists (fun conds -> ctxt#query_all (List.rev_map (fun cond () -> eval None env cond) conds)) conds
           in
           let exec_func h targs coef coefpat ts cont =
             let rules = rules_cell in
@@ -2073,6 +2158,7 @@ module Assertions(VerifyProgramArgs: VERIFY_PROGRAM_ARGS) = struct
   let () = rules_cell := ! rules
 
   let add_rule symb rule = 
+    incr rules_generation;
     (begin match try_assq symb !rules with
       None -> rules := (symb, ref [rule]) :: !rules
     | Some(rs) -> rs := rule :: !rs end;
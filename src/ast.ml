@@ -65,6 +65,14 @@ let rec root_caller_token l =
   | MacroExpansion (lcall, _) -> root_caller_token lcall
   | MacroParamExpansion (lparam, _) -> root_caller_token lparam
 
+(* Like root_caller_token, but None for a location without a source token, such as DummyLoc. *)
+let rec root_caller_token_opt l =
+  match l with
+    Lexed l -> Some l
+  | DummyLoc -> None
+  | MacroExpansion (lcall, _) -> root_caller_token_opt lcall
+  | MacroParamExpansion (lparam, _) -> root_caller_token_opt lparam
+
 let rec string_of_loc l =
   match l with
     Lexed l0 -> string_of_loc0 l0
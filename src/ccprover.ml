@@ -0,0 +1,442 @@
+(* An incomplete but sound prover for equality with uninterpreted functions, built on an array-based union-find with a
+   signature table for congruence closure, after [Nieuwenhuis and Oliveras, Fast congruence closure and extensions].
+
+   Terms are integers indexing the node arrays. Nodes are hash-consed and never freed, since terms may outlive the
+   context in which they were built. Every change to the E-graph, including the registration of a node, is recorded on a
+   single trail, which pop unwinds; there are no per-node pop stacks or closures.
+
+   Besides congruence, the prover knows that distinct literals, and distinct constructors of the same inductive subtype,
+   denote distinct values; it reduces fixpoint applications and conditionals once the value of the argument they
+   inspect is known. Arithmetic and the other connectives are uninterpreted, and quantified axioms are ignored. Hence
+   "Unknown" and "not valid" answers mean nothing; combine this prover with a complete one (see
+   verifastPluginUfRedux.ml). *)
+
+open Num
+open Proverapi
+
+type symbol = {
+  sym_id: int;
+  sym_name: string;
+  sym_kind: symbol_kind;
+  sym_literal: bool; (* Distinct literal symbols denote distinct values. *)
+  mutable sym_fpclauses: (int * (int list -> int list -> int)) list (* For fixpoints: constructor symbol id -> clause. *)
+}
+
+(* The term built between begin_formal and end_formal, or from one: axioms are not supported. *)
+let opaque = -1
+
+type undo =
+  Registered of int (* The node was added to the E-graph *)
+| Linked of int * int (* The first class was linked below the second one *)
+| SignatureAdded of (int * int list)
+| SignatureRemoved of (int * int list) * int
+| UsesSet of int * int list
+| DiseqsSet of int * int list
+| ValueSet of int * int
+| Reduced of int
+| BecameUnsat
+
+class context () =
+  let symbol_counter = ref 0 in
+  let mk_symbol name kind literal =
+    let id = !symbol_counter in
+    incr symbol_counter;
+    {sym_id = id; sym_name = name; sym_kind = kind; sym_literal = literal; sym_fpclauses = []}
+  in
+  let sym_true = mk_symbol "true" Uninterp true in
+  let sym_false = mk_symbol "false" Uninterp true in
+  let sym_eq = mk_symbol "==" Uninterp false in
+  let sym_and = mk_symbol "&&" Uninterp false in
+  let sym_or = mk_symbol "||" Uninterp false in
+  let sym_not = mk_symbol "!" Uninterp false in
+  let sym_iff = mk_symbol "<==>" Uninterp false in
+  let sym_implies = mk_symbol "==>" Uninterp false in
+  let sym_ite = mk_symbol "ite" Uninterp false in
+  let builtin name = mk_symbol name Uninterp false in
+  let sym_add = builtin "+" and sym_sub = builtin "-" and sym_mul = builtin "*" in
+  let sym_div = builtin "/" and sym_mod = builtin "%" in
+  let sym_lt = builtin "<" and sym_le = builtin "<=" in
+  let sym_real_add = builtin "+." and sym_real_sub = builtin "-." and sym_real_mul = builtin "*." in
+  let sym_real_lt = builtin "<." and sym_real_le = builtin "<=." in
+  let sym_boxed_int = builtin "(intbox)" and sym_unboxed_int = builtin "(int)" in
+  let sym_boxed_real = builtin "(realbox)" and sym_unboxed_real = builtin "(real)" in
+  let sym_boxed_bool = builtin "(boolbox)" and sym_unboxed_bool = builtin "(bool)" in
+  object (self)
+    val mutable verbosity = 0
+    val mutable formal_depth = 0
+
+    (* The node arrays, indexed by node. *)
+    val mutable node_count = 0
+    val mutable node_symbol: symbol array = [| |]
+    val mutable node_children: int list array = [| |]
+    val mutable parent: int array = [| |] (* Union-find forest; a class is represented by its root. *)
+    val mutable size: int array = [| |] (* For roots: the number of nodes in the class. *)
+    val mutable uses: int list array = [| |] (* For roots: the nodes that have a child in the class. *)
+    val mutable diseqs: int list array = [| |] (* For roots: nodes known to be distinct from the class. *)
+    val mutable value: int array = [| |] (* For roots: a literal or constructor application in the class, or -1. *)
+    val mutable reduced: bool array = [| |] (* Whether a fixpoint application or conditional has been reduced. *)
+    val mutable registered: bool array = [| |] (* Whether the node is part of the E-graph in the current context. *)
+
+    val hashcons: (int * int list, int) Hashtbl.t = Hashtbl.create 10000
+    val signatures: (int * int list, int) Hashtbl.t = Hashtbl.create 10000
+    val literals: (string, symbol) Hashtbl.t = Hashtbl.create 100
+
+    val mutable trail: undo list = []
+    val mutable trail_length = 0
+    val mutable marks: int list = []
+    val mutable unsat = false
+    val mutable pending_merges: (int * int) list = []
+    val mutable pending_reductions: int list = []
+
+    val mutable merge_count = 0
+    val mutable reduction_count = 0
+    val mutable query_count = 0
+    val mutable registered_count = 0
+
+    val mutable ttrue = opaque
+    val mutable tfalse = opaque
+
+    initializer
+      ttrue <- self#intern sym_true [];
+      tfalse <- self#intern sym_false []
+
+    method set_verbosity v = verbosity <- v
+
+    (* Changes made outside any push are never undone. *)
+    method private record u =
+      if marks <> [] then begin
+        trail <- u::trail;
+        trail_length <- trail_length + 1
+      end
+
+    method private grow =
+      let n = max 1024 (2 * Array.length parent) in
+      let extend a x = let a' = Array.make n x in Array.blit a 0 a' 0 (Array.length a); a' in
+      node_symbol <- extend node_symbol sym_true;
+      node_children <- extend node_children [];
+      parent <- extend parent 0;
+      size <- extend size 0;
+      uses <- extend uses [];
+      diseqs <- extend diseqs [];
+      value <- extend value (-1);
+      reduced <- extend reduced false;
+      registered <- extend registered false
+
+    method private find n =
+      let p = parent.(n) in
+      if p = n then n else self#find p
+
+    method private signature n = (node_symbol.(n).sym_id, List.map self#find node_children.(n))
+
+    method private set_uses r l = self#record (UsesSet (r, uses.(r))); uses.(r) <- l
+    method private set_diseqs r l = self#record (DiseqsSet (r, diseqs.(r))); diseqs.(r) <- l
+
+    method private set_unsat =
+      if not unsat then begin
+        self#record BecameUnsat;
+        unsat <- true
+      end
+
+    method private is_value_symbol s =
+      s.sym_literal || match s.sym_kind with Ctor (CtorByOrdinal _) -> true | _ -> false
+
+    (* Whether the values [v1] and [v2], both literals or constructor applications, are known to be distinct. *)
+    method private values_distinct v1 v2 =
+      let s1 = node_symbol.(v1) and s2 = node_symbol.(v2) in
+      s1.sym_id <> s2.sym_id &&
+      match s1.sym_kind, s2.sym_kind with
+        Ctor (CtorByOrdinal (subtype1, _)), Ctor (CtorByOrdinal (subtype2, _)) -> subtype1 = subtype2
+      | _ -> s1.sym_literal && s2.sym_literal
+
+    (* Whether [n] is a fixpoint application or conditional that can be reduced now. *)
+    method private reducible n =
+      not reduced.(n) &&
+      let s = node_symbol.(n) in
+      match s.sym_kind with
+        Fixpoint (_, k) ->
+        let v = value.(self#find (List.nth node_children.(n) k)) in
+        v >= 0 && List.mem_assoc node_symbol.(v).sym_id s.sym_fpclauses
+      | _ ->
+        s == sym_ite &&
+        let c = self#find (List.hd node_children.(n)) in
+        c = self#find ttrue || c = self#find tfalse
+
+    method private reduce n =
+      if self#reducible n then begin
+        self#record (Reduced n);
+        reduced.(n) <- true;
+        reduction_count <- reduction_count + 1;
+        let s = node_symbol.(n) in
+        let children = node_children.(n) in
+        let result =
+          match s.sym_kind with
+            Fixpoint (_, k) ->
+            let v = value.(self#find (List.nth children k)) in
+            let clause = List.assoc node_symbol.(v).sym_id s.sym_fpclauses in
+            clause children node_children.(v)
+          | _ ->
+            let [c; t1; t2] = children in
+            if self#find c = self#find ttrue then t1 else t2
+        in
+        if result <> opaque then pending_merges <- (n, result)::pending_merges
+      end
+
+    (* Links the class of [a] below the class of [b], or vice versa, and restores the congruence invariant. *)
+    method private union a b =
+      let ra = self#find a and rb = self#find b in
+      if ra <> rb then begin
+        merge_count <- merge_count + 1;
+        let ra, rb = if size.(ra) > size.(rb) then rb, ra else ra, rb in
+        if List.exists (fun d -> self#find d = rb) diseqs.(ra) then self#set_unsat else begin
+          (* The signatures of the nodes that use [ra] change. *)
+          let moved = uses.(ra) in
+          moved |> List.iter begin fun p ->
+            let key = self#signature p in
+            match Hashtbl.find_opt signatures key with
+              Some q when q = p -> Hashtbl.remove signatures key; self#record (SignatureRemoved (key, p))
+            | _ -> ()
+          end;
+          parent.(ra) <- rb;
+          size.(rb) <- size.(rb) + size.(ra);
+          self#record (Linked (ra, rb));
+          let va = value.(ra) and vb = value.(rb) in
+          if va >= 0 then begin
+            if vb < 0 then begin
+              self#record (ValueSet (rb, vb));
+              value.(rb) <- va
+            end else if self#values_distinct va vb then
+              self#set_unsat
+          end;
+          moved |> List.iter begin fun p ->
+            let key = self#signature p in
+            match Hashtbl.find_opt signatures key with
+              Some q -> pending_merges <- (p, q)::pending_merges
+            | None -> Hashtbl.add signatures key p; self#record (SignatureAdded key)
+          end;
+          let users = uses.(rb) in
+          self#set_uses rb (moved @ users);
+          if diseqs.(ra) <> [] then self#set_diseqs rb (diseqs.(ra) @ diseqs.(rb));
+          (* The class may now have a known value, or contain true or false. *)
+          List.iter (fun p -> if self#reducible p then pending_reductions <- p::pending_reductions) (moved @ users)
+        end
+      end
+
+    method private propagate =
+      let rec iter () =
+        if unsat then begin
+          pending_merges <- [];
+          pending_reductions <- []
+        end else
+          match pending_merges, pending_reductions with
+            (a, b)::merges, _ -> pending_merges <- merges; self#union a b; iter ()
+          | [], n::reductions -> pending_reductions <- reductions; self#reduce n; iter ()
+          | [], [] -> ()
+      in
+      iter ()
+
+    method private intern s children =
+      if formal_depth > 0 || List.mem opaque children then opaque else
+      let key = (s.sym_id, children) in
+      let n =
+        match Hashtbl.find_opt hashcons key with
+          Some n -> n
+        | None ->
+          if node_count = Array.length parent then self#grow;
+          let n = node_count in
+          node_count <- n + 1;
+          node_symbol.(n) <- s;
+          node_children.(n) <- children;
+          parent.(n) <- n;
+          size.(n) <- 1;
+          value.(n) <- if self#is_value_symbol s then n else -1;
+          Hashtbl.add hashcons key n;
+          n
+      in
+      if not registered.(n) then self#register n;
+      n
+
+    (* Adds [n] to the E-graph. When the registration is undone, the node's state is back to the singleton class it was
+       created as. *)
+    method private register n =
+      registered.(n) <- true;
+      registered_count <- registered_count + 1;
+      self#record (Registered n);
+      let children = node_children.(n) in
+      List.iter (fun c -> if not registered.(c) then self#register c) children;
+      List.iter (fun c -> let r = self#find c in self#set_uses r (n::uses.(r))) children;
+      if children <> [] then begin
+        let key = self#signature n in
+        match Hashtbl.find_opt signatures key with
+          Some q -> pending_merges <- (n, q)::pending_merges
+        | None -> Hashtbl.add signatures key n; self#record (SignatureAdded key)
+      end;
+      if self#reducible n then pending_reductions <- n::pending_reductions;
+      self#propagate
+
+    method private undo u =
+      match u with
+        Registered n -> registered.(n) <- false; registered_count <- registered_count - 1
+      | Linked (a, b) -> parent.(a) <- a; size.(b) <- size.(b) - size.(a)
+      | SignatureAdded key -> Hashtbl.remove signatures key
+      | SignatureRemoved (key, n) -> Hashtbl.add signatures key n
+      | UsesSet (r, l) -> uses.(r) <- l
+      | DiseqsSet (r, l) -> diseqs.(r) <- l
+      | ValueSet (r, v) -> value.(r) <- v
+      | Reduced n -> reduced.(n) <- false
+      | BecameUnsat -> unsat <- false
+
+    method push =
+      marks <- trail_length::marks
+
+    method pop =
+      match marks with
+        mark::marks' ->
+        marks <- marks';
+        while trail_length > mark do
+          match trail with
+            u::trail' -> trail <- trail'; trail_length <- trail_length - 1; self#undo u
+          | [] -> assert false
+        done
+      | [] -> failwith "Ccprover.pop: no matching push"
+
+    method type_bool = ()
+    method type_int = ()
+    method type_real = ()
+    method type_inductive = ()
+
+    method mk_symbol name (domain: unit list) (range: unit) kind = mk_symbol name kind false
+    method set_fpclauses (s: symbol) (k: int) (cs: (symbol * (int list -> int list -> int)) list) =
+      s.sym_fpclauses <- List.map (fun (c, clause) -> (c.sym_id, clause)) cs
+    method mk_app s ts = self#intern s ts
+
+    method mk_boxed_int t = self#intern sym_boxed_int [t]
+    method mk_unboxed_int t = self#intern sym_unboxed_int [t]
+    method mk_boxed_real t = self#intern sym_boxed_real [t]
+    method mk_unboxed_real t = self#intern sym_unboxed_real [t]
+    method mk_boxed_bool t = self#intern sym_boxed_bool [t]
+    method mk_unboxed_bool t = self#intern sym_unboxed_bool [t]
+    method mk_true = ttrue
+    method mk_false = tfalse
+    method mk_and t1 t2 = self#intern sym_and [t1; t2]
+    method mk_or t1 t2 = self#intern sym_or [t1; t2]
+    method mk_not t = self#intern sym_not [t]
+    method mk_ifthenelse t1 t2 t3 = self#intern sym_ite [t1; t2; t3]
+    method mk_iff t1 t2 = self#intern sym_iff [t1; t2]
+    method mk_implies t1 t2 = self#intern sym_implies [t1; t2]
+    method mk_eq t1 t2 = self#intern sym_eq [t1; t2]
+    method private mk_literal name =
+      let s =
+        match Hashtbl.find_opt literals name with
+          Some s -> s
+        | None -> let s = mk_symbol name Uninterp true in Hashtbl.add literals name s; s
+      in
+      self#intern s []
+    method mk_intlit n = self#mk_literal (string_of_int n)
+    method mk_intlit_of_string s = self#mk_literal (string_of_num (num_of_string s))
+    method mk_add t1 t2 = self#intern sym_add [t1; t2]
+    method mk_sub t1 t2 = self#intern sym_sub [t1; t2]
+    method mk_mul t1 t2 = self#intern sym_mul [t1; t2]
+    method mk_div t1 t2 = self#intern sym_div [t1; t2]
+    method mk_mod t1 t2 = self#intern sym_mod [t1; t2]
+    method mk_lt t1 t2 = self#intern sym_lt [t1; t2]
+    method mk_le t1 t2 = self#intern sym_le [t1; t2]
+    (* Real literals get a "r" suffix so that they are distinct from the integer literals, which have a different sort. *)
+    method mk_reallit n = self#mk_literal (string_of_int n ^ "r")
+    method mk_reallit_of_num n = self#mk_literal (string_of_num n ^ "r")
+    method mk_real_add t1 t2 = self#intern sym_real_add [t1; t2]
+    method mk_real_sub t1 t2 = self#intern sym_real_sub [t1; t2]
+    method mk_real_mul t1 t2 = self#intern sym_real_mul [t1; t2]
+    method mk_real_lt t1 t2 = self#intern sym_real_lt [t1; t2]
+    method mk_real_le t1 t2 = self#intern sym_real_le [t1; t2]
+
+    method pprint t =
+      if t = opaque then "<formal>" else
+      let s = node_symbol.(t) in
+      match node_children.(t) with
+        [] -> s.sym_name
+      | ts -> s.sym_name ^ "(" ^ String.concat ", " (List.map self#pprint ts) ^ ")"
+    method pprint_sort () = "()"
+    method pprint_sym s = s.sym_name
+
+    method private disequal t1 t2 =
+      let r1 = self#find t1 and r2 = self#find t2 in
+      r1 <> r2 &&
+      (List.exists (fun d -> self#find d = r2) diseqs.(r1) ||
+       List.exists (fun d -> self#find d = r1) diseqs.(r2) ||
+       value.(r1) >= 0 && value.(r2) >= 0 && self#values_distinct value.(r1) value.(r2))
+
+    method private assume_true t =
+      let s = node_symbol.(t) in
+      begin match node_children.(t) with
+        [t1; t2] when s == sym_eq || s == sym_iff -> pending_merges <- (t1, t2)::pending_merges
+      | [t1; t2] when s == sym_and -> self#assume_true t1; self#assume_true t2
+      | [t1] when s == sym_not -> self#assume_false t1
+      | _ -> ()
+      end;
+      pending_merges <- (t, ttrue)::pending_merges
+
+    method private assume_false t =
+      let s = node_symbol.(t) in
+      begin match node_children.(t) with
+        [t1; t2] when s == sym_eq || s == sym_iff ->
+        let r1 = self#find t1 and r2 = self#find t2 in
+        if r1 = r2 then self#set_unsat else begin
+          self#set_diseqs r1 (t2::diseqs.(r1));
+          self#set_diseqs r2 (t1::diseqs.(r2))
+        end
+      | [t1; t2] when s == sym_or -> self#assume_false t1; self#assume_false t2
+      | [t1; t2] when s == sym_implies -> self#assume_true t1; self#assume_false t2
+      | [t1] when s == sym_not -> self#assume_true t1
+      | _ -> ()
+      end;
+      pending_merges <- (t, tfalse)::pending_merges
+
+    method assume t =
+      if t <> opaque && not unsat then begin
+        self#assume_true t;
+        self#propagate
+      end;
+      if unsat then Unsat else Unknown
+
+    method assert_term t = ignore (self#assume t)
+
+    method private holds t =
+      let s = node_symbol.(t) in
+      self#find t = self#find ttrue ||
+      match node_children.(t) with
+        [t1; t2] when s == sym_eq || s == sym_iff -> self#find t1 = self#find t2
+      | [t1; t2] when s == sym_and -> self#holds t1 && self#holds t2
+      | [t1; t2] when s == sym_or -> self#holds t1 || self#holds t2
+      | [t1; t2] when s == sym_implies -> self#refuted t1 || self#holds t2
+      | [t1] when s == sym_not -> self#refuted t1
+      | _ -> false
+
+    method private refuted t =
+      let s = node_symbol.(t) in
+      self#find t = self#find tfalse ||
+      match node_children.(t) with
+        [t1; t2] when s == sym_eq || s == sym_iff -> self#disequal t1 t2
+      | [t1; t2] when s == sym_and -> self#refuted t1 || self#refuted t2
+      | [t1; t2] when s == sym_or -> self#refuted t1 && self#refuted t2
+      | [t1; t2] when s == sym_implies -> self#holds t1 && self#refuted t2
+      | [t1] when s == sym_not -> self#holds t1
+      | _ -> false
+
+    method query t =
+      query_count <- query_count + 1;
+      unsat || t <> opaque && self#holds t
+
+    method query_all ts = List.for_all (fun t -> self#query (t ())) ts
+
+    method mk_bitwise (op: bitwise_op) (signed: bool) (width: int) (t1: int) (t2: int): int option = None
+
+    method stats =
+      (Printf.sprintf "Congruence closure: %d nodes (%d in the current context), %d merges, %d reductions, %d queries\n"
+         node_count registered_count merge_count reduction_count query_count, [])
+
+    method begin_formal = formal_depth <- formal_depth + 1
+    method end_formal = formal_depth <- formal_depth - 1
+    method mk_bound (i: int) (tp: unit) = opaque
+    method assume_forall (description: string) (triggers: int list) (tps: unit list) (body: int) = ()
+    method simplify (t: int): int option = None
+  end
@@ -74,7 +74,7 @@ class ['a, 'b, 'c, 'd, 'e, 'f] combined_context (p1 : ('a, 'b, 'c) context)
        Right (r.f p2 a b c)
     | _ -> failwith "map3"
   in
-object
+object (self)
   (* All methods but "set_fpclauses" are trivial. The
      combination_strategy is used in methods "query" and "assume". *)
   method set_verbosity v =
@@ -186,6 +186,16 @@ object
            p1#query t1 || p2#query t2
       end
     | Left _ | Right _ -> failwith "Combineprovers.query"
+  method query_all ts = List.for_all (fun t -> self#query (t ())) ts
+  (* Only available if both provers have a bit-vector theory *)
+  method mk_bitwise op signed width t1 t2 =
+    match (t1, t2) with
+    | (Both (a1, a2), Both (b1, b2)) ->
+       begin match (p1#mk_bitwise op signed width a1 b1, p2#mk_bitwise op signed width a2 b2) with
+       | (Some r1, Some r2) -> Some (Both (r1, r2))
+       | _ -> None
+       end
+    | _ -> None
   method assert_term = function
     | Both (t1, t2) -> begin
         p1#assert_term t1;
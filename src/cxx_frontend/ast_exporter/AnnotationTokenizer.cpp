@@ -0,0 +1,287 @@
+#include "AnnotationTokenizer.h"
+#include "llvm/ADT/StringExtras.h"
+
+namespace vf {
+
+namespace {
+
+class AnnotationTokenizer {
+  using Kind = AnnotationToken::Kind;
+
+  llvm::StringRef _text;
+  unsigned _pos = 0;
+  llvm::SmallVectorImpl<AnnotationToken> &_tokens;
+  llvm::SmallVectorImpl<unsigned> &_lineStarts;
+
+  char peek(unsigned n = 0) const {
+    return _pos + n < _text.size() ? _text[_pos + n] : '\0';
+  }
+
+  void emit(Kind kind, unsigned start) {
+    _tokens.emplace_back(kind, _text.slice(start, _pos), start, _pos);
+  }
+
+  static bool isIdentStart(char c) {
+    return llvm::isAlpha(c) || c == '_' || (unsigned char)c >= 128;
+  }
+
+  static bool isIdentChar(char c) {
+    return isIdentStart(c) || llvm::isDigit(c) || c == '\'' || c == '$';
+  }
+
+  static bool isOperatorChar(char c) {
+    return llvm::StringRef("!%&$#+-/:<=>?@\\~^|*").contains(c);
+  }
+
+  bool word() {
+    unsigned start = _pos++;
+    for (;;) {
+      if (isIdentChar(peek())) {
+        ++_pos;
+      } else if (peek() == ':' && peek(1) == ':') {
+        // C++ nested names, e.g. foo::bar
+        _pos += 2;
+      } else {
+        break;
+      }
+    }
+    emit(Kind::Word, start);
+    // VeriFast lexes the file name of an include directive differently.
+    return _tokens.back().spelling != "include";
+  }
+
+  void operatorRun() {
+    unsigned start = _pos++;
+    while (isOperatorChar(peek()))
+      ++_pos;
+    emit(Kind::Symbol, start);
+  }
+
+  void digits() {
+    while (llvm::isDigit(peek()))
+      ++_pos;
+  }
+
+  void exponent() {
+    if (peek() == '+' || peek() == '-')
+      ++_pos;
+    digits();
+  }
+
+  void intSuffix() {
+    auto isU = [](char c) { return c == 'u' || c == 'U'; };
+    auto isL = [](char c) { return c == 'l' || c == 'L'; };
+    if (isU(peek())) {
+      ++_pos;
+      if (isL(peek())) {
+        ++_pos;
+        if (isL(peek()))
+          ++_pos;
+      }
+    } else if (isL(peek())) {
+      ++_pos;
+      if (isL(peek())) {
+        ++_pos;
+        if (isU(peek()))
+          ++_pos;
+      } else if (isU(peek())) {
+        ++_pos;
+      }
+    }
+  }
+
+  void number() {
+    unsigned start = _pos;
+    digits();
+    if (peek() == 'x') {
+      ++_pos;
+      while (llvm::isHexDigit(peek()))
+        ++_pos;
+      intSuffix();
+    } else if (peek() == '.' && llvm::isDigit(peek(1))) {
+      ++_pos;
+      digits();
+      if (peek() == 'e' || peek() == 'E') {
+        ++_pos;
+        exponent();
+      }
+    } else if (peek() == 'e' || peek() == 'E') {
+      ++_pos;
+      exponent();
+    } else if (peek() == 'r') {
+      ++_pos;
+    } else {
+      intSuffix();
+    }
+    emit(Kind::Literal, start);
+  }
+
+  // Skips one (possibly escaped) character of a character or string literal.
+  bool literalChar() {
+    char c = peek();
+    if ((unsigned char)c < ' ')
+      return false;
+    ++_pos;
+    if (c != '\\')
+      return true;
+    c = peek();
+    if (c >= '0' && c <= '3') {
+      ++_pos;
+      for (int i = 0; i < 2 && peek() >= '0' && peek() <= '7'; ++i)
+        ++_pos;
+      return true;
+    }
+    if (c == 'x') {
+      ++_pos;
+      if (!llvm::isHexDigit(peek()) || !llvm::isHexDigit(peek(1)))
+        return false;
+      _pos += 2;
+      return true;
+    }
+    if ((unsigned char)c < ' ')
+      return false;
+    ++_pos;
+    return true;
+  }
+
+  bool quoted(char quote) {
+    unsigned start = _pos++;
+    if (quote == '\'') {
+      if (!literalChar() || peek() != '\'')
+        return false;
+    } else {
+      while (peek() != '"') {
+        if (!literalChar())
+          return false;
+      }
+    }
+    ++_pos;
+    emit(Kind::Literal, start);
+    return true;
+  }
+
+public:
+  AnnotationTokenizer(llvm::StringRef text,
+                      llvm::SmallVectorImpl<AnnotationToken> &tokens,
+                      llvm::SmallVectorImpl<unsigned> &lineStarts)
+      : _text(text), _tokens(tokens), _lineStarts(lineStarts) {}
+
+  bool tokenize() {
+    if (_text.size() < 3)
+      return false;
+    bool singleLine = _text[1] == '/';
+    _pos = 3;
+    _tokens.emplace_back(Kind::Symbol, "/*@", 0, 3);
+
+    for (;;) {
+      unsigned start = _pos;
+      char c = peek();
+      switch (c) {
+      case '\0':
+        if (_pos < _text.size())
+          return false;
+        if (singleLine) {
+          // VeriFast ends a single-line annotation at the end of the line.
+          _tokens.emplace_back(Kind::Symbol, "@*/", _pos, _pos);
+          return true;
+        }
+        // A multi-line annotation ends with its '@*/' delimiter.
+        return _tokens.size() > 1 && _tokens.back().spelling == "@*/";
+      case ' ':
+      case '\t':
+      case '\x1a':
+      case '\f':
+        ++_pos;
+        break;
+      case '\r':
+      case '\n':
+        ++_pos;
+        if (c == '\r' && peek() == '\n')
+          ++_pos;
+        _lineStarts.push_back(_pos);
+        break;
+      case '\\':
+        if (peek(1) == '\n' || peek(1) == '\r')
+          return false;
+        operatorRun();
+        break;
+      case '(':
+        ++_pos;
+        emit(Kind::Symbol, start);
+        break;
+      case '!':
+        ++_pos;
+        if (peek() == '=')
+          ++_pos;
+        emit(Kind::Symbol, start);
+        break;
+      case '<':
+      case '%':
+      case '&':
+      case '$':
+      case '#':
+      case '+':
+      case '-':
+      case '=':
+      case '>':
+      case '?':
+      case '@':
+      case '~':
+      case '^':
+      case '|':
+        operatorRun();
+        break;
+      case '.':
+        ++_pos;
+        for (int i = 0; i < 2 && peek() == '.'; ++i)
+          ++_pos;
+        emit(Kind::Symbol, start);
+        break;
+      case '/':
+        if (peek(1) == '/' || peek(1) == '*')
+          return false;
+        ++_pos;
+        if (peek() == '=')
+          ++_pos;
+        emit(Kind::Symbol, start);
+        break;
+      case '*':
+        ++_pos;
+        if (peek() == '=')
+          ++_pos;
+        emit(Kind::Symbol, start);
+        break;
+      case '\'':
+      case '"':
+        if (!quoted(c))
+          return false;
+        break;
+      default:
+        if (llvm::isDigit(c)) {
+          number();
+        } else if (isIdentStart(c)) {
+          if (!word())
+            return false;
+        } else {
+          ++_pos;
+          emit(Kind::Symbol, start);
+        }
+      }
+    }
+  }
+};
+
+} // namespace
+
+bool tokenizeAnnotation(llvm::StringRef text,
+                        llvm::SmallVectorImpl<AnnotationToken> &tokens,
+                        llvm::SmallVectorImpl<unsigned> &lineStarts) {
+  AnnotationTokenizer tokenizer(text, tokens, lineStarts);
+  if (tokenizer.tokenize())
+    return true;
+  tokens.clear();
+  lineStarts.clear();
+  return false;
+}
+
+} // namespace vf
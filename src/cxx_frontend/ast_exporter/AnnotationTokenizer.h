@@ -0,0 +1,44 @@
+#pragma once
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/StringRef.h"
+
+namespace vf {
+
+/**
+ * A token of a VeriFast annotation.
+ */
+struct AnnotationToken {
+  enum class Kind { Word, Symbol, Literal };
+
+  Kind kind;
+  llvm::StringRef spelling;
+  unsigned start;
+  unsigned end;
+
+  AnnotationToken(Kind kind, llvm::StringRef spelling, unsigned start,
+                  unsigned end)
+      : kind(kind), spelling(spelling), start(start), end(end) {}
+};
+
+/**
+ * Splits the text of an annotation into tokens, following the rules of
+ * VeriFast's lexer for ghost code. Keywords are not distinguished from
+ * identifiers and literals are not interpreted: VeriFast does that itself.
+ *
+ * Gives up on annotations that contain constructs which only VeriFast's lexer
+ * handles faithfully: nested comments (which may carry should-fail
+ * directives), line continuations, include directives and malformed literals.
+ * Such annotations are only sent as text.
+ *
+ * @param text the text of the annotation, starting with its '/\*@' or '//@'
+ * delimiter.
+ * @param[out] tokens the tokens of the annotation.
+ * @param[out] lineStarts the offsets at which the second, third, ... line of
+ * the annotation start.
+ * @return whether or not the annotation could be tokenized.
+ */
+bool tokenizeAnnotation(llvm::StringRef text,
+                        llvm::SmallVectorImpl<AnnotationToken> &tokens,
+                        llvm::SmallVectorImpl<unsigned> &lineStarts);
+
+} // namespace vf
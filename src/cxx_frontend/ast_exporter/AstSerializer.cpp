@@ -80,6 +80,10 @@ void AstSerializer::serializeTU(stubs::TU::Builder &builder,
       };
 
   _inclContext.serializeTUInclDirectives(builder, _SM, getFirstDeclOpt);
+
+  // All annotations have been serialized at this point.
+  auto spellings = builder.initAnnSpellings(_AS.getNbSpellings());
+  _AS.serializeSpellings(spellings);
 }
 
 } // namespace vf
\ No newline at end of file
@@ -1,11 +1,14 @@
 #pragma once
 #include "Annotation.h"
+#include "AnnotationTokenizer.h"
 #include "loc_serializer.h"
 #include "clang/AST/DeclVisitor.h"
 #include "clang/AST/StmtVisitor.h"
 #include "clang/AST/TypeLocVisitor.h"
 #include "clang/AST/TypeVisitor.h"
 #include "clang/Lex/Preprocessor.h"
+#include "llvm/ADT/StringMap.h"
+#include <vector>
 
 namespace vf {
 
@@ -359,6 +362,51 @@ public:
 
 class AnnotationSerializer {
   clang::SourceManager &_SM;
+  llvm::StringMap<uint32_t> _spellingIds;
+  std::vector<llvm::StringRef> _spellings;
+
+  uint32_t internSpelling(llvm::StringRef spelling) {
+    auto result = _spellingIds.try_emplace(spelling, _spellings.size());
+    if (result.second)
+      _spellings.push_back(result.first->getKey());
+    return result.first->getValue();
+  }
+
+  /**
+   * Serializes the tokens of the given annotation, so VeriFast does not have
+   * to lex its text again. Nothing is serialized if the annotation cannot be
+   * tokenized; VeriFast then lexes the text itself.
+   */
+  template <class InitTokens>
+  void serializeTokens(const Annotation &ann, InitTokens initTokens) {
+    llvm::SmallVector<AnnotationToken, 32> tokens;
+    llvm::SmallVector<unsigned, 4> lineStarts;
+    if (!tokenizeAnnotation(ann.getText(), tokens, lineStarts))
+      return;
+    stubs::AnnTokens::Builder tokensBuilder = initTokens();
+    auto lineStartsBuilder = tokensBuilder.initLineStarts(lineStarts.size());
+    for (size_t i(0); i < lineStarts.size(); ++i)
+      lineStartsBuilder.set(i, lineStarts[i]);
+    auto tokenListBuilder = tokensBuilder.initTokens(tokens.size());
+    size_t i(0);
+    for (auto &token : tokens) {
+      auto tokenBuilder = tokenListBuilder[i++];
+      switch (token.kind) {
+      case AnnotationToken::Kind::Word:
+        tokenBuilder.setKind(stubs::AnnToken::Kind::WORD);
+        break;
+      case AnnotationToken::Kind::Symbol:
+        tokenBuilder.setKind(stubs::AnnToken::Kind::SYMBOL);
+        break;
+      case AnnotationToken::Kind::Literal:
+        tokenBuilder.setKind(stubs::AnnToken::Kind::LITERAL);
+        break;
+      }
+      tokenBuilder.setSpelling(internSpelling(token.spelling));
+      tokenBuilder.setStart(token.start);
+      tokenBuilder.setEnd(token.end);
+    }
+  }
 
 public:
   explicit AnnotationSerializer(clang::SourceManager &SM) : _SM(SM) {}
@@ -369,6 +417,7 @@ public:
     auto locBuilder = builder.initLoc();
     serializeSrcRange(locBuilder, ann.getRange(), _SM);
     builder.setText(ann.getText().str());
+    serializeTokens(ann, [&builder] { return builder.initTokens(); });
   }
 
   template <class StubsNode>
@@ -377,7 +426,20 @@ public:
                      const Annotation &ann) {
     serializeSrcRange(locBuilder, ann.getRange(), _SM);
     descBuilder.setAnn(ann.getText().str());
+    serializeTokens(ann, [&descBuilder] { return descBuilder.initAnnTokens(); });
   }
+
+  /**
+   * Serializes the spellings of all annotation tokens serialized so far. Token
+   * spellings refer to this list by index.
+   */
+  void serializeSpellings(capnp::List<capnp::Text>::Builder builder) const {
+    for (size_t i(0); i < _spellings.size(); ++i)
+      builder.set(i, capnp::Text::Reader(_spellings[i].data(),
+                                         _spellings[i].size()));
+  }
+
+  size_t getNbSpellings() const { return _spellings.size(); }
 };
 
 } // namespace vf
\ No newline at end of file
@@ -6,7 +6,20 @@ exception CxxAnnParseException of VF.loc * string
 let error (loc: VF.loc) (msg: string) =
   raise @@ CxxAnnParseException (loc, msg)
 
-type raw_annotation = VF.loc0 * string
+type ann_token_kind = WordToken | SymbolToken | LiteralToken
+
+(*
+  Tokens of an annotation as lexed by the C++ AST exporter. Each token consists of its kind, the index of its spelling
+  in the spelling table of the translation unit, and its start and end byte offsets relative to the start of the annotation.
+  [line_starts] holds the offsets at which the second, third, ... line of the annotation start.
+*)
+type ann_tokens = {
+  line_starts: int array;
+  tokens: (ann_token_kind * int * int * int) array;
+}
+
+(* Location and text of an annotation, and its tokens if the exporter was able to lex it. *)
+type raw_annotation = VF.loc0 * string * ann_tokens option
 
 module Make (Args: Cxx_fe_sig.CXX_TRANSLATOR_ARGS) = struct
 
@@ -20,13 +33,104 @@ module Make (Args: Cxx_fe_sig.CXX_TRANSLATOR_ARGS) = struct
     end
   )
 
-  let make_lexer_token_stream (((start_loc, _), text): raw_annotation) =
+  let make_lexer_token_stream (start_loc: VF.srcpos) (text: string) =
     let loc, _, token_stream, _, _ = Lexer.make_lexer_core
       (Parser.common_keywords @ Parser.c_keywords) Parser.ghost_keywords start_loc (text ^ "\n") (* append a newline to be able to parse //@ annotations *)
       report_range false false true report_should_fail Lexer.default_file_options.annot_char 
     in
     loc, token_stream
 
+  let ghost_keywords =
+    let table = Hashtbl.create 256 in
+    Parser.common_keywords @ Parser.c_keywords @ Parser.ghost_keywords |> List.iter (fun kwd -> Hashtbl.replace table kwd ());
+    table
+
+  (* Spelling table of the translation unit whose annotations are being parsed. *)
+  let spellings: string array ref = ref [||]
+
+  (* Lexer tokens of the spellings, computed on first use. *)
+  let spelling_tokens: (int, Lexer.token option) Hashtbl.t = Hashtbl.create 1024
+
+  let set_spellings (table: string array) =
+    spellings := table;
+    Hashtbl.clear spelling_tokens
+
+  (*
+    [token_of_spelling kind spelling] returns the lexer token for [spelling], or None if VeriFast's lexer
+    would not produce a single token for it (e.g. an unknown operator, for which it reports an error).
+  *)
+  let token_of_spelling (kind: ann_token_kind) (spelling: string): Lexer.token option =
+    match kind with
+      WordToken -> Some (if Hashtbl.mem ghost_keywords spelling then Lexer.Kwd spelling else Lexer.Ident spelling)
+    | SymbolToken -> if spelling = "/*@" || spelling = "@*/" || Hashtbl.mem ghost_keywords spelling then Some (Lexer.Kwd spelling) else None
+    | LiteralToken ->
+      (* Literals are rare; let the lexer interpret them. *)
+      let _, _, token_stream, _, _ = Lexer.make_lexer_core [] [] ("", 1, 1) spelling (fun _ _ -> ()) false true true (fun _ _ -> ()) Lexer.default_file_options.annot_char in
+      try
+        match Lexer.Stream.peek token_stream with
+          Some (_, (Lexer.Int _ | Lexer.RealToken _ | Lexer.RationalToken _ | Lexer.String _ | Lexer.CharToken _ as token)) -> Some token
+        | _ -> None
+      with Stream.Failure | Stream.Error _ | Lexer.ParseException _ -> None
+
+  let cached_token_of_spelling (kind, spelling_id, _, _) =
+    match Hashtbl.find_opt spelling_tokens spelling_id with
+      Some token -> token
+    | None ->
+      let token = token_of_spelling kind (!spellings).(spelling_id) in
+      Hashtbl.add spelling_tokens spelling_id token;
+      token
+
+  exception NotPretokenized
+
+  (*
+    [make_pretokenized_stream start_loc ann_tokens] returns a token stream for an annotation lexed by the exporter,
+    reporting the same ranges as the lexer, or raises NotPretokenized if a token has no lexer counterpart.
+  *)
+  let make_pretokenized_stream (start_loc: VF.srcpos) ({line_starts; tokens}: ann_tokens) =
+    let lexer_tokens = tokens |> Array.map (fun token -> match cached_token_of_spelling token with Some t -> t | None -> raise NotPretokenized) in
+    let path, line, col = start_loc in
+    let srcpos_of_offset offset =
+      (* Annotations rarely span more than a few lines. *)
+      let rec count_lines k = if k < Array.length line_starts && line_starts.(k) <= offset then count_lines (k + 1) else k in
+      match count_lines 0 with
+        0 -> (path, line, col + offset)
+      | k -> (path, line + k, offset - line_starts.(k - 1) + 1)
+    in
+    let locs = tokens |> Array.map (fun (_, _, start, end_) -> (srcpos_of_offset start, srcpos_of_offset end_)) in
+    let n = Array.length tokens in
+    if n > 0 then begin
+      lexer_tokens |> Array.iteri begin fun i token ->
+        match token with
+          Lexer.Kwd ("/*@" | "@*/") -> report_range Lexer.GhostRangeDelimiter locs.(i)
+        | Lexer.Kwd kwd when kwd.[0] >= 'a' && kwd.[0] <= 'z' || kwd.[0] = '_' -> report_range Lexer.GhostKeywordRange locs.(i)
+        | _ -> ()
+      end;
+      report_range Lexer.GhostRange (fst locs.(0), snd locs.(n - 1))
+    end;
+    let eof_loc = if n = 0 then (start_loc, start_loc) else let (_, end_pos) = locs.(n - 1) in (end_pos, end_pos) in
+    (* Like the lexer, count the lines that hold a token as ghost lines. *)
+    let ghost_line_count =
+      let (_, count) = locs |> Array.fold_left (fun (last_line, count) ((_, line, _), _) -> if line = last_line then (last_line, count) else (line, count + 1)) (0, 0) in
+      count
+    in
+    let current = ref (start_loc, start_loc) in
+    let next_token i =
+      if i < n then begin current := locs.(i); Some (locs.(i), lexer_tokens.(i)) end
+      else if i = n then begin
+        current := eof_loc;
+        !Stats.stats#overhead ~path ~nonGhostLineCount:0 ~ghostLineCount:ghost_line_count ~mixedLineCount:0;
+        Some (eof_loc, Lexer.Eof)
+      end
+      else None
+    in
+    (fun () -> !current), Stream.from next_token
+
+  let make_token_stream (((start_loc, _), text, tokens_opt): raw_annotation) =
+    match tokens_opt with
+      None -> make_lexer_token_stream start_loc text
+    | Some tokens ->
+      try make_pretokenized_stream start_loc tokens with NotPretokenized -> make_lexer_token_stream start_loc text
+
   let try_parse ann_parser (current_loc, token_stream) =
     try
       ann_parser @@ Parser.noop_preprocessor token_stream
@@ -35,10 +139,10 @@ module Make (Args: Cxx_fe_sig.CXX_TRANSLATOR_ARGS) = struct
     | Stream.Failure -> error (VF.Lexed (current_loc ())) "Parse error in ghost code."
 
   let try_parse_ghost (ann: raw_annotation) ann_parser =
-    try_parse ann_parser @@ make_lexer_token_stream ann
+    try_parse ann_parser @@ make_token_stream ann
 
   let parse_ann_list (anns: raw_annotation list) ann_parser =
-    let lexers = anns |> List.map make_lexer_token_stream |> ref in
+    let lexers = anns |> List.map make_token_stream |> ref in
     let current_loc () =
       let (c_loc, _) :: _ = !lexers in c_loc
     in
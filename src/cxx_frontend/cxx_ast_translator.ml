@@ -119,11 +119,32 @@ module Make (Args: Cxx_fe_sig.CXX_TRANSLATOR_ARGS) : Cxx_fe_sig.Cxx_Ast_Translat
     let l_end = if has_end loc then end_get loc |> transl_srcpos else VF.dummy_srcpos in
     VF.Lexed (l_start, l_end)
 
+  (**
+    [transl_ann_tokens tokens] translates the tokens of an annotation as lexed by the C++ AST exporter.
+  *)
+  let transl_ann_tokens (tokens: R.AnnTokens.t): Cxx_annotation_parser.ann_tokens =
+    let open R.AnnTokens in
+    let transl_token token =
+      let open R.AnnToken in
+      let kind =
+        match kind_get token with
+        | R.AnnToken.Kind.Word -> Cxx_annotation_parser.WordToken
+        | R.AnnToken.Kind.Symbol -> Cxx_annotation_parser.SymbolToken
+        | _ -> Cxx_annotation_parser.LiteralToken
+      in
+      kind, spelling_get_int_exn token, start_get_int_exn token, end_get_int_exn token
+    in
+    {
+      Cxx_annotation_parser.line_starts = line_starts_get_array tokens |> Array.map Stdint.Uint32.to_int;
+      tokens = tokens_get tokens |> Capnp.Array.map_array ~f:transl_token;
+    }
+
   let map_ann_clause ann =
     let open R.Clause in
     let VF.Lexed a_loc = loc_get ann |> transl_loc in
     let a_text = text_get ann in
-    a_loc, a_text
+    let a_tokens = if has_tokens ann then Some (tokens_get ann |> transl_ann_tokens) else None in
+    a_loc, a_text, a_tokens
 
   (*************)
   (* top level *)
@@ -165,7 +186,7 @@ module Make (Args: Cxx_fe_sig.CXX_TRANSLATOR_ARGS) : Cxx_fe_sig.Cxx_Ast_Translat
     | UnionNotInitialized -> union_no_init_err "declaration"
     | Empty               -> []
     | Function f          -> [transl_func_decl loc f]
-    | Ann a               -> transl_ann_decls loc a
+    | Ann a               -> transl_ann_decls loc a (if has_ann_tokens desc then Some (ann_tokens_get desc |> transl_ann_tokens) else None)
     | Record r            -> transl_record_decl loc r
     | Method m            -> if method_is_implicit m then [] else [transl_meth_decl loc m]
     | Var v               -> [transl_var_decl_global loc v]
@@ -216,7 +237,7 @@ module Make (Args: Cxx_fe_sig.CXX_TRANSLATOR_ARGS) : Cxx_fe_sig.Cxx_Ast_Translat
     match get desc with
     | UnionNotInitialized -> union_no_init_err "statement"
     | Decl decls          -> transl_decl_stmt loc decls
-    | Ann a               -> transl_stmt_ann loc a
+    | Ann a               -> transl_stmt_ann loc a (if has_ann_tokens desc then Some (ann_tokens_get desc |> transl_ann_tokens) else None)
     | Expr e              -> transl_expr_stmt e
     | Return r            -> transl_return_stmt loc r
     | If i                -> transl_if_stmt loc i
@@ -305,9 +326,9 @@ module Make (Args: Cxx_fe_sig.CXX_TRANSLATOR_ARGS) : Cxx_fe_sig.Cxx_Ast_Translat
     in
     VF.Func (loc, VF.Regular, [], return_type, name, params, ng_callers_only, ft, pre_post, terminates, body_stmts, VF.Static, VF.Public)
 
-  and transl_ann_decls (loc: VF.loc) (text: string): VF.decl list =
+  and transl_ann_decls (loc: VF.loc) (text: string) (tokens: Cxx_annotation_parser.ann_tokens option): VF.decl list =
     let VF.Lexed l = loc in
-    AP.parse_decls (l, text)
+    AP.parse_decls (l, text, tokens)
 
   and transl_var_init (i: R.Decl.Var.VarInit.t): VF.expr =
     let open R.Decl.Var.VarInit in
@@ -634,9 +655,9 @@ module Make (Args: Cxx_fe_sig.CXX_TRANSLATOR_ARGS) : Cxx_fe_sig.Cxx_Ast_Translat
     let expect_var loc desc = match R.Decl.get desc with R.Decl.Var v -> Some (transl_var_decl_local loc v) | _ -> None in
     VF.DeclStmt (loc, decls |> capnp_arr_map (transl_expect expect_var))
 
-  and transl_stmt_ann (loc: VF.loc) (text: string): VF.stmt =
+  and transl_stmt_ann (loc: VF.loc) (text: string) (tokens: Cxx_annotation_parser.ann_tokens option): VF.stmt =
     let VF.Lexed l = loc in
-    AP.parse_stmt (l, text)
+    AP.parse_stmt (l, text, tokens)
 
   and transl_compound_stmt (loc: VF.loc) (c: R.Stmt.Compound.t): VF.stmt =
     let open R.Stmt.Compound in
@@ -833,6 +854,7 @@ module Make (Args: Cxx_fe_sig.CXX_TRANSLATOR_ARGS) : Cxx_fe_sig.Cxx_Ast_Translat
 
   let transl_tu (tu: R.TU.t): Cxx_fe_sig.header_type list * VF.decl list =
     let open R.TU in
+    ann_spellings_get_array tu |> AP.set_spellings;
     files_get tu |> transl_files;
     let main_fd = main_fd_get tu in
     let main_decls = pop_fd_decls main_fd in
@@ -201,9 +201,9 @@ let keywords = [
 ]
 
 let make_lexer keywords lines =
-  let buffer = ref "" in
-  let append c = buffer := !buffer ^ (String.make 1 c) in
-  let reset_buffer () = let b = !buffer in buffer := ""; b in
+  let buffer = Buffer.create 64 in
+  let append c = Buffer.add_char buffer c in
+  let reset_buffer () = let b = Buffer.contents buffer in Buffer.clear buffer; b in
   let str = 
     try
       join_lines_fail lines
@@ -226,6 +226,9 @@ let make_lexer keywords lines =
   let junk () = Stream.junk stream in
   let kwd_table = Hashtbl.create 17 in
   List.iter (fun s -> Hashtbl.add kwd_table s (Kwd s)) keywords;
+  (* Single-character keywords terminate identifiers; look them up without allocating a string per character *)
+  let single_char_kwd = Array.make 256 false in
+  List.iter (fun s -> if String.length s = 1 then single_char_kwd.(int_of_char s.[0]) <- true) keywords;
   let ident_or_key () =
     let s = reset_buffer () in
     if Hashtbl.mem kwd_table s then
@@ -235,8 +238,8 @@ let make_lexer keywords lines =
   in
   let rec make_ident_or_key () =
     match peek () with 
-      _ as c when (Hashtbl.mem kwd_table (String.make 1 c)) -> 
-            if (String.length !buffer > 0 ) then
+      _ as c when single_char_kwd.(int_of_char c) -> 
+            if (Buffer.length buffer > 0 ) then
               ident_or_key ()
             else
               (junk(); Some (Kwd (String.make 1 c)))
@@ -246,7 +249,7 @@ let make_lexer keywords lines =
             ident_or_key ()
     | _ as c -> error NoSource ("Internal Error!\n" ^
                 "AST Lexer encountered unexpected character while scanning identifier/keyword " ^
-                !buffer ^ " : " ^ (Printf.sprintf "%i" (int_of_char c)))
+                Buffer.contents buffer ^ " : " ^ (Printf.sprintf "%i" (int_of_char c)))
   in
   
   let rec make_num () =
@@ -201,13 +201,14 @@ object (this)
 
   method receive_response =
     let lines = this#receive_message in
-    let message = Misc.join_lines_never_fail lines in
-    debug_print ("receive_response got message: \n" ^ message);
+    (* Responses to FILES requests carry whole ASTs; only join them when reporting an error *)
+    let message () = Misc.join_lines_never_fail lines in
+    debug_print ("receive_response got message of " ^ string_of_int (List.length lines) ^ " lines");
     if (List.length lines < 1) then
       this#error ("Received an empty message from the ASTServer");
     let kind = List.hd lines in
     if not (List.mem kind responses) then
-        this#error ("Received an incomprehensible message from the ASTServer: \n" ^ message);
+        this#error ("Received an incomprehensible message from the ASTServer: \n" ^ message ());
     if kind = response_abort then begin
       this#unload;
       this#error ("ASTServer aborted\n")
@@ -215,7 +216,7 @@ object (this)
     let parts = List.tl lines in
     if kind = response_failure then begin
       if (List.length parts < 2) then
-        this#error ("Received an incomprehensible error message from the ASTServer: \n" ^ message);
+        this#error ("Received an incomprehensible error message from the ASTServer: \n" ^ message ());
       let l = Ast_reader.parse_line_with Ast_reader.parse_loc (List.hd parts) in
       raise (Ast_reader.AstReaderException(l, Misc.join_lines_never_fail (List.tl parts)))
     end;
@@ -105,11 +105,14 @@ let buffer_add_json_pp buf indent json =
     | v -> buffer_add_json buf v in
   iter 0 json
 
-let print_json_endline json =
+let output_json_endline oc json =
   let buf = Buffer.create 1024 in
   buffer_add_json buf json;
-  Buffer.output_buffer stdout buf;
-  print_newline ()
+  Buffer.output_buffer oc buf;
+  output_char oc '\n';
+  flush oc
+
+let print_json_endline json = output_json_endline stdout json
 
 let pprint_json_endline indent json =
   let buf = Buffer.create 1024 in
@@ -117,7 +120,7 @@ let pprint_json_endline indent json =
   Buffer.output_buffer stdout buf;
   print_newline ()
 
-type json_token_type = LBracket | RBracket | LBrace | RBrace | Comma | Colon | NullToken | True | False | Integer | String | Eof
+type json_token_type = LBracket | RBracket | LBrace | RBrace | Comma | Colon | NullToken | True | False | Integer | Float | String | Eof
 
 let string_of_token_type = function
   LBracket -> "'['"
@@ -130,6 +133,7 @@ let string_of_token_type = function
 | True -> "'true'"
 | False -> "'false'"
 | Integer -> "integer"
+| Float -> "number"
 | String -> "string"
 | Eof -> "end of input"
 
@@ -232,12 +236,32 @@ let next_json_token lexer =
       junk lexer;
       Buffer.clear lexer.tokenValue;
       Buffer.add_char lexer.tokenValue c;
-      let rec parse_number () =
+      let rec parse_digits () =
         match peek lexer with
-          '0'..'9' as c -> junk lexer; Buffer.add_char lexer.tokenValue c; parse_number ()
-        | _ -> Integer
+          '0'..'9' as c -> junk lexer; Buffer.add_char lexer.tokenValue c; parse_digits ()
+        | _ -> ()
       in
-      parse_number ()
+      parse_digits ();
+      let is_float = ref false in
+      if peek lexer = '.' then begin
+        junk lexer;
+        Buffer.add_char lexer.tokenValue '.';
+        is_float := true;
+        parse_digits ()
+      end;
+      begin match peek lexer with
+        'e'|'E' ->
+        junk lexer;
+        Buffer.add_char lexer.tokenValue 'e';
+        is_float := true;
+        begin match peek lexer with
+          '+'|'-' as c -> junk lexer; Buffer.add_char lexer.tokenValue c
+        | _ -> ()
+        end;
+        parse_digits ()
+      | _ -> ()
+      end;
+      if !is_float then Float else Integer
     | 'n' ->
       junk lexer;
       expect lexer 'u';
@@ -297,6 +321,12 @@ let parse_json text =
         Some i -> next_json_token lexer; I i
       | None -> parse_error lexer "The integer is outside of the range supported by this JSON parser"
       end
+    | Float ->
+      let value = lexer_get_value lexer in
+      begin match float_of_string_opt value with
+        Some f -> next_json_token lexer; F f
+      | None -> parse_error lexer "Malformed number"
+      end
     | LBrace ->
       next_json_token lexer;
       begin match lexer.tokenType with
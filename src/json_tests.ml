@@ -17,3 +17,9 @@ let () =
     buffer_add_json_pp buf 2 j;
     assert(Buffer.contents buf = "{\n  \"key\": \"value\",\n  \"arr\": {\n    \"nested_arr\": [\n      [\n        null,\n        10,\n        []\n      ],\n      \"string\",\n      true\n    ],\n    \"empty object\": {}\n  }\n}")
   end
+
+let () =
+  assert(parse_json "[1.5, -2e3, 0.25E-1, 7]" = A [F 1.5; F (-2000.); F 0.025; I 7]);
+  let buf = Buffer.create 64 in
+  buffer_add_json buf (F 0.1);
+  assert(parse_json (Buffer.contents buf) = F 0.1)
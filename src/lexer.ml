@@ -123,6 +123,7 @@ type file_options = {
   annot_char: char;
   tab_size: int;
   disable_overflow_check: bool option;
+  bitvectors: bool option;
   prover: string option;
   target: string option
 }
@@ -130,7 +131,7 @@ type file_options = {
 exception FileOptionsError of string
 
 let default_file_options =
-  {annot_char='@'; tab_size=8; disable_overflow_check=None; prover=None; target=None}
+  {annot_char='@'; tab_size=8; disable_overflow_check=None; bitvectors=None; prover=None; target=None}
 
 let get_file_options text =
   let tokens = get_first_line_tokens text in
@@ -148,6 +149,8 @@ let get_file_options text =
       iter true opts toks
     | "disable_overflow_check"::toks when inVFBlock ->
       iter inVFBlock {opts with disable_overflow_check=Some true} toks
+    | "bitvectors"::toks when inVFBlock ->
+      iter inVFBlock {opts with bitvectors=Some true} toks
     | "prover"::":"::prover::toks when inVFBlock ->
       iter inVFBlock {opts with prover=Some prover} toks
     | "target"::":"::target::toks when inVFBlock ->
@@ -156,7 +159,7 @@ let get_file_options text =
       iter false opts toks
     | tok::toks ->
       if inVFBlock then
-        raise (FileOptionsError ("No such VeriFast option: '" ^ tok ^ "'; example: verifast_annotation_char:@ tab_size:4 verifast_options{disable_overflow_check prover:z3v4.5 target:32bit}"))
+        raise (FileOptionsError ("No such VeriFast option: '" ^ tok ^ "'; example: verifast_annotation_char:@ tab_size:4 verifast_options{disable_overflow_check bitvectors prover:z3v4.5 target:32bit}"))
       else
         iter inVFBlock opts toks
     | [] -> opts
@@ -872,7 +875,7 @@ let make_lexer_core keywords ghostKeywords startpos text reportRange inComment i
    ignore_eol,
    Stream.from (fun count ->
      (try
-        match next_token () with
+        match with_alloc_subsystem AllocLexer next_token with
           Some t -> Some (current_loc(), t)
         | None -> None
       with
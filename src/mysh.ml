@@ -43,6 +43,7 @@ let dots = ref false  (* Print only a dot for successfully terminated processes.
 let verbose = ref false
 let main_filename = ref "standard input"
 let main_file = ref stdin
+let history_filename = ref None  (* File that records process durations across runs; used to start the longest processes first. *)
 
 let () =
   let rec iter args =
@@ -57,6 +58,9 @@ let () =
     | "-verbose"::args ->
       verbose := true;
       iter args
+    | "-history"::filename::args ->
+      history_filename := Some filename;
+      iter args
     | filename::args when String.length filename > 0 && filename.[0] <> '-' ->
       main_filename := filename;
       let file = try open_in filename with Sys_error s -> failwith (Printf.sprintf "Could not open file '%s': %s" filename s) in
@@ -64,7 +68,7 @@ let () =
       iter args
     | arg::args ->
       Printf.printf "Invalid argument: %s\n" arg;
-      print_endline "Usage: mysh [-cpus n] [-dots] [-verbose] [filename]";
+      print_endline "Usage: mysh [-cpus n] [-dots] [-verbose] [-history filename] [filename]";
       exit 1
   in
   iter (List.tl (Array.to_list Sys.argv))
@@ -111,9 +115,75 @@ let semaphore initialValue =
   in
   acquire, release
 
+(* Like [semaphore], but [acquire priority] grants permission to the waiting thread with the highest priority first,
+   and among threads with equal priority to the one that started waiting first. *)
+let priority_semaphore initialValue =
+  let count = ref initialValue in
+  let waiting = ref [] in
+  let ticket_counter = ref 0 in
+  let mutex = Mutex.create () in
+  let cond = Condition.create () in
+  let acquire priority =
+    Mutex.lock mutex;
+    incr ticket_counter;
+    let ticket = (priority, - !ticket_counter) in
+    waiting := ticket::!waiting;
+    while !count = 0 || List.exists (fun t -> compare t ticket > 0) !waiting do
+      Condition.wait cond mutex
+    done;
+    waiting := List.filter (fun t -> t <> ticket) !waiting;
+    decr count;
+    Condition.broadcast cond;
+    Mutex.unlock mutex
+  in
+  let release () =
+    Mutex.lock mutex;
+    incr count;
+    Condition.broadcast cond;
+    Mutex.unlock mutex
+  in
+  acquire, release
+
 let processes_started_counter = atomic_counter ()
 
-let acquire_run_permission, release_run_permission = semaphore !max_processes
+let acquire_run_permission, release_run_permission = priority_semaphore !max_processes
+
+(* Durations (in seconds) of processes, keyed by command line prefixed with the working directory *)
+let history: (string, float) Hashtbl.t = Hashtbl.create 1000
+
+let () =
+  match !history_filename with
+    Some path when Sys.file_exists path ->
+    let file = open_in path in
+    begin try
+      while true do
+        let line = input_line file in
+        (* Malformed lines, e.g. from an interrupted save, are skipped. *)
+        match String.index_opt line '\t' with
+          Some tab ->
+          begin match float_of_string_opt (String.sub line 0 tab) with
+            Some duration -> Hashtbl.replace history (String.sub line (tab + 1) (String.length line - tab - 1)) duration
+          | None -> ()
+          end
+        | None -> ()
+      done
+    with End_of_file -> ()
+    end;
+    close_in file
+  | _ -> ()
+
+let save_history () =
+  match !history_filename with
+    None -> ()
+  | Some path ->
+    let file = open_out path in
+    Hashtbl.fold (fun cmd duration entries -> (cmd, duration)::entries) history []
+      |> List.sort compare
+      |> List.iter (fun (cmd, duration) -> Printf.fprintf file "%.2f\t%s\n" duration cmd);
+    close_out file
+
+(* Start and finish times of the processes of the current run, for the schedule summary *)
+let process_timings: (string * float * float) list ref = ref []
 
 let failed_processes_log: string list list ref = ref []
 let global_mutex = Mutex.create ()
@@ -347,6 +417,7 @@ let rec exec_cmds macros cwd parallel cmds =
         ["cd"; dir] -> cd l dir
       | ["del"; file] -> join_children (); Sys.remove (get_abs_path file)
       | ["ifnotmac"; line] -> if Vfconfig.platform <> MacOS then exec_line line
+      | ["ifnotwin"; line] -> if Vfconfig.platform <> Windows then exec_line line
       | ["ifz3"; line] -> if Vfconfig.z3_present then exec_line line
       | ["ifz3v4.5"; line] -> if Vfconfig.z3v4dot5_present then exec_line line
       | ["ifdef"; line] ->
@@ -365,66 +436,71 @@ let rec exec_cmds macros cwd parallel cmds =
       | [cmdName; args] when List.mem_assoc cmdName !macros ->
         List.iter (fun line -> exec_line (Printf.sprintf "%s %s" line args)) (List.assoc cmdName !macros)
       | _ ->
-        acquire_run_permission ();
-        let pid = processes_started_counter () in
-        if !verbose then do_print_line (Printf.sprintf "Starting process %d" pid);
-        let time0 = Unix.gettimeofday () in
         let cwd = getcwd () in
+        let abs_cwd = get_abs_path "." in
         let line' = if cwd = "." then line else cwd ^ "$ " ^ line in
-        Mutex.lock global_mutex;
-        Sys.chdir (get_abs_path ".");
-        let cin = Unix.open_process_in (line ^ " 2>&1") in
-        Mutex.unlock global_mutex;
-        let current_alarm = ref None in
-        let rec produce_alarm i =
-          let runtime = i * 5 in
-          let alarm = create_alarm (time0 +. float_of_int runtime) begin fun () ->
-              Mutex.lock global_mutex;
-              print_endline (Printf.sprintf "SLOW: %s has been running for %ds" line' runtime);
-              produce_alarm (i + 1);
-              Mutex.unlock global_mutex
-            end
+        (* In a parallel block, wait for permission in a child thread so that the block's remaining processes
+           also get queued, and the longest ones (according to the history) are started first. *)
+        run_child begin fun () ->
+          let expected_duration = Mutex.lock global_mutex; let d = Hashtbl.find_opt history line' in Mutex.unlock global_mutex; d in
+          acquire_run_permission (match expected_duration with None -> infinity | Some d -> d);
+          let pid = processes_started_counter () in
+          if !verbose then do_print_line (Printf.sprintf "Starting process %d" pid);
+          let time0 = Unix.gettimeofday () in
+          Mutex.lock global_mutex;
+          Sys.chdir abs_cwd;
+          let cin = Unix.open_process_in (line ^ " 2>&1") in
+          Mutex.unlock global_mutex;
+          let current_alarm = ref None in
+          let rec produce_alarm i =
+            let runtime = i * 5 in
+            let alarm = create_alarm (time0 +. float_of_int runtime) begin fun () ->
+                Mutex.lock global_mutex;
+                print_endline (Printf.sprintf "SLOW: %s has been running for %ds" line' runtime);
+                produce_alarm (i + 1);
+                Mutex.unlock global_mutex
+              end
+            in
+            current_alarm := Some alarm
           in
-          current_alarm := Some alarm
-        in
-        produce_alarm 1;
-        run_child
-          begin fun () ->
-            let output = ref [] in
-            if !verbose then push output line';
-            try
-              while true do
-                let line = input_line cin in
-                push output line;
-                if !verbose then do_print_line (Printf.sprintf "[%d]%s" pid line)
-              done
-            with End_of_file -> ();
-            let status = Unix.close_process_in cin in
-            Mutex.lock global_mutex;
-            let time1 = Unix.gettimeofday() in
-            if !verbose then print_endline (Printf.sprintf "[%d]%f seconds\n" pid (time1 -. time0));
-            let Some alarm = !current_alarm in
-            cancel_alarm alarm;
-            if status <> Unix.WEXITED 0 then begin
-              let msg =
-                if !verbose then
-                  Printf.sprintf "=== Process %d %s ===" pid (string_of_status status)
-                else
-                  Printf.sprintf "FAIL: %s %s" line' (string_of_status status)
-              in
-              let lines = msg::List.map (fun s -> "> " ^ s) (List.rev !output) in
-              let msg = if !verbose then msg else String.concat "\n" lines in
-              print_endline msg;
-              push failed_processes_log lines
-            end else begin
-              if !dots then
-                print_dot ()
+          produce_alarm 1;
+          let output = ref [] in
+          if !verbose then push output line';
+          try
+            while true do
+              let line = input_line cin in
+              push output line;
+              if !verbose then do_print_line (Printf.sprintf "[%d]%s" pid line)
+            done
+          with End_of_file -> ();
+          let status = Unix.close_process_in cin in
+          Mutex.lock global_mutex;
+          let time1 = Unix.gettimeofday() in
+          if !verbose then print_endline (Printf.sprintf "[%d]%f seconds\n" pid (time1 -. time0));
+          let Some alarm = !current_alarm in
+          cancel_alarm alarm;
+          Hashtbl.replace history line' (time1 -. time0);
+          push process_timings (line', time0, time1);
+          if status <> Unix.WEXITED 0 then begin
+            let msg =
+              if !verbose then
+                Printf.sprintf "=== Process %d %s ===" pid (string_of_status status)
               else
-                print_endline (Printf.sprintf "PASS: %s (%.2fs)" line' (time1 -. time0))
-            end;
-            Mutex.unlock global_mutex;
-            release_run_permission ()
-          end
+                Printf.sprintf "FAIL: %s %s" line' (string_of_status status)
+            in
+            let lines = msg::List.map (fun s -> "> " ^ s) (List.rev !output) in
+            let msg = if !verbose then msg else String.concat "\n" lines in
+            print_endline msg;
+            push failed_processes_log lines
+          end else begin
+            if !dots then
+              print_dot ()
+            else
+              print_endline (Printf.sprintf "PASS: %s (%.2fs)" line' (time1 -. time0))
+          end;
+          Mutex.unlock global_mutex;
+          release_run_permission ()
+        end
       in
       exec_line line
       end
@@ -435,12 +511,32 @@ let rec exec_cmds macros cwd parallel cmds =
   exec_cmds0 cmds;
   join_children ()
 
+(* Shows how far the run was from the best achievable schedule: the run cannot finish before its longest process,
+   nor before the total process time has been divided over the available CPUs. Processes that finish late are the
+   ones to start earlier. *)
+let print_schedule_summary time0 time1 =
+  let timings = !process_timings in
+  if timings <> [] then begin
+    let total = List.fold_left (fun total (_, t0, t1) -> total +. (t1 -. t0)) 0.0 timings in
+    let longest = List.fold_left (fun longest (_, t0, t1) -> max longest (t1 -. t0)) 0.0 timings in
+    Printf.printf "Total process time: %.2f seconds; longest process: %.2f seconds; lower bound on execution time with %d CPUs: %.2f seconds\n"
+      total longest !max_processes (max longest (total /. float_of_int !max_processes));
+    print_endline "Processes that finished last (start - finish, in seconds since start):";
+    timings
+      |> List.sort (fun (_, _, t1) (_, _, t1') -> compare t1' t1)
+      |> List.iteri begin fun i (line, t0, t1) ->
+        if i < 10 then Printf.printf "  %7.2f - %7.2f (%6.2fs) %s\n" (t0 -. time0) (t1 -. time0) (t1 -. t0) line
+      end
+  end
+
 let () =
   let time0 = Unix.gettimeofday() in
   let lines = read_file_lines !main_filename !main_file in
   let cmds = parse_file lines in
   exec_cmds [] [] false cmds;
   let time1 = Unix.gettimeofday() in
+  save_history ();
+  if !verbose || !history_filename <> None then print_schedule_summary time0 time1;
   Printf.printf "Total execution time: %f seconds\n" (time1 -. time0);
   List.rev !failed_processes_log |> List.iter begin fun lines ->
     print_newline ();
@@ -1738,7 +1738,7 @@ let parse_scala_file (path: string) (reportRange: range_kind -> loc0 -> unit): p
 let parse_java_file_old (path: string) (reportRange: range_kind -> loc0 -> unit) reportShouldFail verbose enforceAnnotations: package =
   Stopwatch.start parsing_stopwatch;
   if verbose = -1 then Printf.printf "%10.6fs: >> parsing Java file: %s \n" (Perf.time()) path;
-  let result =
+  let result = with_gc_phase gc_phase_parsing @@ fun () ->
   if Filename.check_suffix (Filename.basename path) ".scala" then
     parse_scala_file path reportRange
   else
@@ -1808,7 +1808,7 @@ let parse_c_file (path: string) (reportRange: range_kind -> loc0 -> unit) (repor
             (include_paths: string list) (define_macros: string list) (enforceAnnotations: bool) (dataModel: data_model option): ((loc * (include_kind * string * string) * string list * package list) list * package list) = (* ?parse_c_file *)
   Stopwatch.start parsing_stopwatch;
   if verbose = -1 then Printf.printf "%10.6fs: >> parsing C file: %s \n" (Perf.time()) path;
-  let result =
+  let result = with_gc_phase gc_phase_parsing @@ fun () ->
     let make_lexer path include_paths ~inGhostRange =
       let text = readFile path in
       make_lexer (common_keywords @ c_keywords) ghost_keywords path text reportRange ~inGhostRange reportShouldFail
@@ -1833,7 +1833,7 @@ let parse_header_file (path: string) (reportRange: range_kind -> loc0 -> unit) (
   Stopwatch.start parsing_stopwatch;
   if verbose = -1 then Printf.printf "%10.6fs: >> parsing Header file: %s \n" (Perf.time()) path;
   let isGhostHeader = Filename.check_suffix path ".gh" in
-  let result =
+  let result = with_gc_phase gc_phase_parsing @@ fun () ->
     let make_lexer path include_paths ~inGhostRange =
       let text = readFile path in
       make_lexer (common_keywords @ c_keywords) ghost_keywords path text reportRange ~inGhostRange:inGhostRange reportShouldFail
@@ -47,6 +47,8 @@ end
 type ctor_symbol = CtorByOrdinal of InductiveSubtype.t * int | NumberCtor of num
 type symbol_kind = Ctor of ctor_symbol | Fixpoint of InductiveSubtype.t * int | Uninterp
 
+type bitwise_op = BvAnd | BvOr | BvXor
+
 class virtual ['typenode, 'symbol, 'termnode] context =
   object
     method virtual set_verbosity: int -> unit
@@ -98,6 +100,14 @@ class virtual ['typenode, 'symbol, 'termnode] context =
     method virtual assert_term: 'termnode -> unit
     method virtual assume: 'termnode -> assume_result
     method virtual query: 'termnode -> bool
+    (* Returns true if each of the terms is valid. The terms are built on demand, so that provers that check them one by
+       one can stop at the first one that is not valid; provers that run as a separate process build them all and send
+       the queries in one batch. *)
+    method virtual query_all: (unit -> 'termnode) list -> bool
+    (* [mk_bitwise op signed width t1 t2] returns a term that denotes [op] applied to [t1] and [t2], read as integers of
+       [width] bits (in two's complement if [signed]), computed by the prover's bit-vector theory. Returns None if the
+       prover has no bit-vector theory. *)
+    method virtual mk_bitwise: bitwise_op -> bool -> int -> 'termnode -> 'termnode -> 'termnode option
     method virtual stats: string * (string * int64) list
     method virtual begin_formal: unit
     method virtual end_formal: unit
@@ -105,3 +115,106 @@ class virtual ['typenode, 'symbol, 'termnode] context =
     method virtual assume_forall: string (* description for diagnostic traces *) -> 'termnode list -> ('typenode) list -> 'termnode -> unit
     method virtual simplify: 'termnode -> 'termnode option
   end
+
+(* Quantifier instantiation profiling, enabled by vfconsole's -qi_profile options. The verifier keeps [qi_source] set to
+   the location of the statement being verified, so that the provers can attribute each instantiation to the statement
+   whose verification caused it. *)
+
+let qi_profiling = ref false
+let qi_source = ref "(no statement)"
+
+type qi_axiom_profile = {
+  mutable qi_instances: int;
+  mutable qi_time: float; (* Seconds spent asserting the instantiated bodies *)
+  mutable qi_max_generation: int; (* Length of the longest chain of instantiations that led to an instance of this axiom *)
+  qi_sources: (string, int ref) Hashtbl.t (* Number of instances per statement *)
+}
+
+let qi_axioms: (string, qi_axiom_profile) Hashtbl.t = Hashtbl.create 100
+
+(* Number of instances per cascade: the statement, followed by the axioms whose instances created the triggering terms,
+   outermost first. *)
+let qi_stacks: (string list, int ref) Hashtbl.t = Hashtbl.create 100
+
+let qi_clear () =
+  Hashtbl.clear qi_axioms;
+  Hashtbl.clear qi_stacks
+
+let qi_axiom_profile axiom =
+  try
+    Hashtbl.find qi_axioms axiom
+  with Not_found ->
+    let p = {qi_instances = 0; qi_time = 0.0; qi_max_generation = 0; qi_sources = Hashtbl.create 10} in
+    Hashtbl.add qi_axioms axiom p;
+    p
+
+let qi_incr tbl key count =
+  match try Some (Hashtbl.find tbl key) with Not_found -> None with
+    Some r -> r := !r + count
+  | None -> Hashtbl.add tbl key (ref count)
+
+(* [cascade] lists the axioms whose instances led to these instances, outermost first, ending with [axiom] itself. *)
+let qi_record_instances axiom count cascade =
+  let p = qi_axiom_profile axiom in
+  p.qi_instances <- p.qi_instances + count;
+  p.qi_max_generation <- max p.qi_max_generation (List.length cascade);
+  qi_incr p.qi_sources !qi_source count;
+  qi_incr qi_stacks (!qi_source::cascade) count
+
+let qi_record_time axiom time =
+  let p = qi_axiom_profile axiom in
+  p.qi_time <- p.qi_time +. time
+
+(* Writes the cascades in the folded stack format read by flame graph tools: one line per cascade, with its frames
+   separated by semicolons, followed by the number of instances. *)
+let qi_write_folded_stacks filename =
+  let frame s = String.map (fun c -> if c = ';' || c = '\n' then ' ' else c) s in
+  let chan = open_out_bin filename in
+  qi_stacks |> Hashtbl.iter (fun stack count ->
+    output_string chan (String.concat ";" (List.map frame stack));
+    output_string chan (" " ^ string_of_int !count ^ "\n")
+  );
+  close_out chan
+
+(* Per-function verification budgets, enabled by vfconsole's -function_timeout and -function_memory_limit options. The
+   verifier sets them around the verification of each function body and calls [check_budget] at each symbolic execution
+   step; Redux also calls it while splitting cases and instantiating quantifiers, so that a single runaway query is
+   interrupted as well. *)
+
+exception BudgetExceeded of string
+
+let budget_active = ref false
+let budget_timeout = ref None (* Seconds *)
+let budget_deadline = ref infinity
+let budget_memory_limit = ref None (* Megabytes of major heap growth *)
+let budget_heap_words0 = ref 0
+let budget_check_count = ref 0
+
+let start_budget timeout memoryLimit =
+  budget_active := true;
+  budget_timeout := timeout;
+  budget_deadline := (match timeout with None -> infinity | Some t -> Perf.time () +. t);
+  budget_memory_limit := memoryLimit;
+  budget_heap_words0 := (Gc.quick_stat ()).Gc.heap_words
+
+let stop_budget () =
+  budget_active := false
+
+(* Only every 256th call actually looks at the clock and the heap. *)
+let check_budget () =
+  if !budget_active then begin
+    incr budget_check_count;
+    if !budget_check_count land 255 = 0 then begin
+      begin match !budget_timeout with
+        Some t when Perf.time () > !budget_deadline ->
+        budget_active := false;
+        raise (BudgetExceeded (Printf.sprintf "Function timeout (%g seconds) exceeded" t))
+      | _ -> ()
+      end;
+      match !budget_memory_limit with
+        Some mb when ((Gc.quick_stat ()).Gc.heap_words - !budget_heap_words0) / (1048576 / (Sys.word_size / 8)) > mb ->
+        budget_active := false;
+        raise (BudgetExceeded (Printf.sprintf "Function memory limit (%d MB) exceeded" mb))
+      | _ -> ()
+    end
+  end
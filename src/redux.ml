@@ -107,6 +107,34 @@ let term_subst bound_env t =
   in
   iter t
 
+(* Renames the bound variables of the arguments of a trigger to 0, 1, ... in order of first occurrence, so that triggers
+   that are equal up to renaming share their matching work. Also returns, for each new index, the original index. *)
+let normalize_trigger_args args =
+  let renaming = ref [] in
+  let rec iter pat =
+    match pat with
+      BoundVar i ->
+      begin match try_assoc i !renaming with
+        Some j -> BoundVar j
+      | None -> let j = List.length !renaming in renaming := (i, j)::!renaming; BoundVar j
+      end
+    | App (s, args, t) -> App (s, List.map iter args, t)
+    | _ -> pat
+  in
+  let args = List.map iter args in
+  (args, List.map (fun (i, j) -> (j, i)) !renaming)
+
+let rec pattern_equal p1 p2 =
+  match p1, p2 with
+    BoundVar i1, BoundVar i2 -> i1 = i2
+  | NumLit n1, NumLit n2 -> n1 =/ n2
+  | App (s1, args1, _), App (s2, args2, _) -> s1 == s2 && List.length args1 = List.length args2 && List.for_all2 pattern_equal args1 args2
+  | _ -> false
+
+(* Maximum number of instances of a single axiom that can be live at the same time; 0 means no limit.
+   Instances are discarded when the context in which they were created is popped. Bounds the work done by matching loops. *)
+let max_axiom_instantiations = ref 0
+
 module NumMap = Map.Make (struct type t = num let compare a b = compare_num a b end)
 
 let zero_num = num_of_int 0
@@ -134,7 +162,18 @@ class symbol (kind: symbol_kind) (name: string) =
         cs;
       fpclauses <- Some a
     val mutable apply_listeners = []
-    method applied term = List.iter (fun listener -> listener term) apply_listeners
+    val mutable applications: termnode list = [] (* The applications of this symbol in the current context; used to match triggers against existing terms. *)
+    val mutable applications_pushdepth = 0
+    method applications = applications
+    method applied (ctxt: context) term =
+      if ctxt#pushdepth <> applications_pushdepth then begin
+        let applications0 = applications in
+        let applications_pushdepth0 = applications_pushdepth in
+        ctxt#register_popaction (fun () -> applications <- applications0; applications_pushdepth <- applications_pushdepth0);
+        applications_pushdepth <- ctxt#pushdepth
+      end;
+      applications <- term::applications;
+      List.iter (fun listener -> listener term) apply_listeners
     method add_apply_listener ctxt listener =
       let listeners = apply_listeners in
       apply_listeners <- listener::listeners;
@@ -149,9 +188,11 @@ and termnode (ctxt: context) s initial_children =
     val mutable children: valuenode list = initial_children
     val mutable value = new valuenode ctxt
     val mutable reduced = false
+    val qi_cascade: string list = if !qi_profiling then ctxt#qi_cascade else [] (* The axiom instances that led to the creation of this term, innermost first. *)
     method kind = symbol#kind
     method symbol = symbol
     method children = children
+    method qi_cascade = qi_cascade
     method push =
       if context#pushdepth <> pushdepth then
       begin
@@ -184,7 +225,7 @@ and termnode (ctxt: context) s initial_children =
       in
       iter 0 initial_children;
       value#set_initial_child (self :> termnode);
-      symbol#applied (self :> termnode);
+      symbol#applied ctxt (self :> termnode);
       match symbol#kind with
         Ctor _ -> ()
       | Fixpoint (subtype, k) ->
@@ -729,6 +770,10 @@ and context () =
     val int_mod_symbol = new symbol Uninterp "%"
 
     val mutable numnodes: termnode NumMap.t = NumMap.empty (* Sorted *)
+    (* E-matching index: for each symbol (by Oo.id), the arguments of the triggers headed by that symbol, each with the
+       instantiation functions of the axioms that use it. Axioms whose triggers are equal up to renaming of bound
+       variables share a single set of match listeners. *)
+    val trigger_index: (int, ((symbol, termnode) term list * ((int * termnode) list -> unit) list ref) list) Hashtbl.t = Hashtbl.create 100
     val mutable ttrue = None
     val mutable tfalse = None
     val simplex = Simplex.new_simplex ()
@@ -751,10 +796,14 @@ and context () =
     val mutable max_falsenode_childcount = 0
     val mutable assume_core_count = 0
     val mutable split_count = 0
+    val mutable propagated_split_count = 0
     val mutable simplex_assert_ge_count = 0
     val mutable simplex_assert_eq_count = 0
     val mutable simplex_assert_neq_count = 0
     val mutable axioms: (string * int ref) list = []
+    val mutable duplicate_instantiation_count = 0
+    val mutable qi_cascade: string list = [] (* When profiling, the axiom instances whose bodies are being asserted, innermost first. *)
+    val mutable limited_instantiation_count = 0
     val assumes_with_pending_splits = Array.make 30 0
     val mutable assumes_with_more_pending_splits = 0
     
@@ -797,21 +846,27 @@ and context () =
           # toplevel assumes and queries (with # pending case splits) = %s\n\
           assume_core_count = %d\n\
           number of case splits = %d\n\
+          number of splits decided by propagation = %d\n\
           simplex_assert_ge_count = %d\n\
           simplex_assert_eq_count = %d\n\
           simplex_assert_neq_count = %d\n\
           max_truenode_childcount = %d\n\
           max_falsenode_childcount = %d\n\
+          axiom instantiations skipped as duplicates = %d\n\
+          axiom instantiations skipped because of -redux_max_axiom_instantiations = %d\n\
           axiom triggered counts:\n%s\n\
         "
         pendingSplitsInfo
         assume_core_count
         split_count
+        propagated_split_count
         simplex_assert_ge_count
         simplex_assert_eq_count
         simplex_assert_neq_count
         max_truenode_childcount
         max_falsenode_childcount
+        duplicate_instantiation_count
+        limited_instantiation_count
         axiomTriggerCounts
       in
         (text, ["Time spent in query, assume, push, pop", Stopwatch.ticks stopwatch; "Time spent in Simplex", simplex#get_ticks])
@@ -1048,16 +1103,25 @@ and context () =
       let time0 = if verbosity > 0 then begin trace_entering "Redux.assert_term(%s)" (self#pprint t); Perf.time() end else 0.0 in
       Stopwatch.start stopwatch;
       self#register_pending_splits_count;
-      let result = self#assume_internal t in
+      let depth = pushdepth in
+      let result = try self#assume_internal t with BudgetExceeded _ as e -> self#unwind_budget_exceeded depth e in
       Stopwatch.stop stopwatch;
       if verbosity > 0 && result = Unsat then trace "Redux.assert_term: dropping Unsat result!";
       if verbosity > 0 then begin let time1 = Perf.time() in trace_exiting "Redux.assert_term: %.6f seconds" (time1 -. time0) end
     
+    (* A per-function budget may be exceeded in the middle of a case split; undo the splits' pushes before passing on
+       the exception. *)
+    method unwind_budget_exceeded: 'a. int -> exn -> 'a = fun depth e ->
+      while pushdepth > depth do self#pop_internal done;
+      Stopwatch.stop stopwatch;
+      raise e
+    
     method assume t =
       let time0 = if verbosity > 0 then begin trace_entering "Redux.assume(%s)" (self#pprint t); Perf.time() end else 0.0 in
       Stopwatch.start stopwatch;
       self#register_pending_splits_count;
-      let result = self#assume_internal t in
+      let depth = pushdepth in
+      let result = try self#assume_internal t with BudgetExceeded _ as e -> self#unwind_budget_exceeded depth e in
       Stopwatch.stop stopwatch;
       if verbosity > 0 then begin let time1 = Perf.time() in trace_exiting "Redux.assume: %.6f seconds" (time1 -. time0) end;
       result
@@ -1067,13 +1131,18 @@ and context () =
       Stopwatch.start stopwatch;
       assert (not self#prune_pending_splits);
       self#register_pending_splits_count;
+      let depth = pushdepth in
       self#push_internal;
-      let result = self#assume_internal (Not t) in
+      let result = try self#assume_internal (Not t) with BudgetExceeded _ as e -> self#unwind_budget_exceeded depth e in
       self#pop_internal;
       Stopwatch.stop stopwatch;
       if verbosity > 0 then trace_exiting "Redux.query";
       result = Unsat
     
+    method query_all ts = List.for_all (fun t -> self#query (t ())) ts
+    
+    method mk_bitwise (op: bitwise_op) (signed: bool) (width: int) (t1: (symbol, termnode) term) (t2: (symbol, termnode) term): (symbol, termnode) term option = None
+    
     method get_type (term: (symbol, termnode) term) = ()
 
     method termnode_of_poly n ts =
@@ -1112,6 +1181,7 @@ and context () =
       | _ -> failwith ("Redux does not yet support this term: " ^ self#pprint t)
 
     method pushdepth = pushdepth
+    method qi_cascade = qi_cascade
     method push =
       Stopwatch.start stopwatch;
       self#push_internal;
@@ -1228,27 +1298,95 @@ and context () =
       in
       iter 0 pending_splits_front
     
+    (* Decides the pending splits that are not real choices in the current context: if one branch of a split is
+       inconsistent with the current assumptions, its other branch is assumed; if a branch already holds, the split is
+       satisfied. This is repeated until no more splits can be decided, so that splits that are irrelevant to a
+       refutation are never branched on, and the search is no longer exponential in the number of independent splits.
+       Returns None if the current assumptions are inconsistent, and otherwise [decided] extended with the splits
+       decided in the current context. When [assumptions] is empty, the current context is the one in which the splits
+       were added, so decided splits are marked such that later calls assume the chosen branch directly. *)
+    method propagate_pending_splits assumptions decided node =
+      let rec undecided node =
+        match !node with
+          None -> []
+        | Some (`SplitNode (branch1, branch2, nextNode)) ->
+          let rest = undecided nextNode in
+          if List.memq node decided then rest else (node, branch1, branch2, nextNode)::rest
+      in
+      let try_branch branch =
+        self#push_internal;
+        let result = self#assume_with_implications branch in
+        self#pop_internal;
+        result
+      in
+      let rec round decided =
+        let splits = undecided node in
+        (* Probing costs two assumes per split; below this number of splits, plain backtracking is cheaper. *)
+        if List.length splits < 3 then Some decided else
+        let rec iter changed decided splits =
+          match splits with
+            [] -> if changed then round decided else Some decided
+          | (node, branch1, branch2, nextNode)::splits ->
+            let decide branch =
+              propagated_split_count <- propagated_split_count + 1;
+              if verbosity >= 2 then trace "Propagated split: %s" (self#pprint branch);
+              if assumptions = [] then begin
+                let nodeValue = !node in
+                self#register_popaction (fun () -> node := nodeValue);
+                node := Some (`SplitNode (False, branch, nextNode))
+              end;
+              if self#assume_with_implications branch = Unsat3 then None else iter true (node::decided) splits
+            in
+            match try_branch branch1 with
+              Unsat3 -> decide branch2
+            | Valid3 -> iter changed (node::decided) splits
+            | Unknown3 ->
+              match try_branch branch2 with
+                Unsat3 -> decide branch1
+              | Valid3 -> iter changed (node::decided) splits
+              | Unknown3 -> iter changed decided splits
+        in
+        iter false decided splits
+      in
+      round decided
+
     (** If this method returns true, then the current theory is unsatisfiable. *)
     method perform_pending_splits cont =
-      let rec iter assumptions currentNode =
+      (* Propagation only pays off once the search backtracks; satisfiable searches usually succeed on their first path. *)
+      let backtracked = ref false in
+      let rec iter assumptions decided currentNode =
+        match if !backtracked then self#propagate_pending_splits assumptions decided currentNode else Some decided with
+          None -> true
+        | Some decided ->
+        let rec next_undecided node =
+          match !node with
+            Some (`SplitNode (_, _, nextNode)) when List.memq node decided -> next_undecided nextNode
+          | _ -> node
+        in
+        (* Splits decided when [assumptions] is empty hold in the current context, so pruning them along with the
+           current split below is sound. *)
+        let currentNode = next_undecided currentNode in
         match !currentNode with
           None -> cont assumptions
         | Some (`SplitNode (branch1, branch2, nextNode)) as currentNodeValue->
           split_count <- split_count + 1;
+          check_budget ();
           if verbosity >= 2 then trace_entering "splitting on (%s, %s) (depth: %d)" (self#pprint branch1) (self#pprint branch2) (List.length assumptions);
           self#push_internal;
           if verbosity >= 2 then begin trace "First branch: %s" (self#pprint branch1); indent () end;
           let result = self#assume_with_implications branch1 in
           if verbosity >= 2 then begin unindent (); trace "Branch yields %s" (match result with Unsat3 -> "Unsat" | Unknown3 -> "Unknown" | Valid3 -> "Valid") end;
-          let continue = result = Unsat3 || result = Valid3 && assumptions = [] || iter (branch1::assumptions) nextNode in
+          let continue = result = Unsat3 || result = Valid3 && assumptions = [] || iter (branch1::assumptions) decided nextNode in
+          if continue && result <> Valid3 then backtracked := true;
           self#pop_internal;
           if assumptions = [] && result <> Unknown3 then
           begin
             if verbosity >= 2 then trace "Pruning split";
-            self#register_popaction (fun () -> pending_splits_front <- currentNode);
+            let pendingSplitsFront = pending_splits_front in
+            self#register_popaction (fun () -> pending_splits_front <- pendingSplitsFront);
             pending_splits_front <- nextNode;
             let result = if result = Unsat3 then self#assume_with_implications branch2 else Valid3 in
-            let continue = result = Unsat3 || iter [] nextNode in
+            let continue = result = Unsat3 || iter [] decided nextNode in
             if verbosity >= 2 then trace_exiting "splitting";
             continue
           end
@@ -1259,7 +1397,7 @@ and context () =
               if verbosity >= 2 then begin trace "Second branch %s" (self#pprint branch2); indent () end;
               let result = self#assume_with_implications branch2 in
               if verbosity >= 2 then begin unindent (); trace "Branch yields %s" (match result with Unsat3 -> "Unsat" | Unknown3 -> "Unknown" | Valid3 -> "Valid") end;
-              let continue = result = Unsat3 || iter (branch2::assumptions) nextNode in
+              let continue = result = Unsat3 || iter (branch2::assumptions) decided nextNode in
               self#pop_internal;
               if assumptions = [] && not continue then
               begin
@@ -1269,7 +1407,8 @@ and context () =
                   self#register_popaction (fun () -> currentNode := currentNodeValue);
                   currentNode := Some (`SplitNode (False, branch1, nextNode))
                 | Valid3 ->
-                  self#register_popaction (fun () -> pending_splits_front <- currentNode);
+                  let pendingSplitsFront = pending_splits_front in
+                  self#register_popaction (fun () -> pending_splits_front <- pendingSplitsFront);
                   pending_splits_front <- nextNode
                 | Unknown3 -> ()
               end;
@@ -1280,7 +1419,7 @@ and context () =
           if verbosity >= 2 then trace_exiting "splitting";
           continue
       in
-      iter [] pending_splits_front
+      iter [] [] pending_splits_front
     
     method prune_pending_splits =
       let rec iter () =
@@ -1303,16 +1442,20 @@ and context () =
     method mk_app (s: symbol) (ts: (symbol, termnode) term list): (symbol, termnode) term =
       let termnode =
         if formal_depth = 0 then
-          let ts = List.map self#termnode_of_term ts in
-          let vs = List.map (fun t -> t#value) ts in
-          let t = self#get_node s vs in
-          if verbosity > 20 then trace "mk_app: caching termnode %s" t#pprint;
-          Some t
+          (* Test the flag here, so that a run without -stats does not allocate the closure. *)
+          Some (if !Stats.alloc_attribution then Stats.with_alloc_subsystem Stats.AllocTermNodes (fun () -> self#app_termnode s ts) else self#app_termnode s ts)
         else
           None
       in
       App (s, ts, termnode)
     
+    method private app_termnode (s: symbol) (ts: (symbol, termnode) term list): termnode =
+      let ts = List.map self#termnode_of_term ts in
+      let vs = List.map (fun t -> t#value) ts in
+      let t = self#get_node s vs in
+      if verbosity > 20 then trace "mk_app: caching termnode %s" t#pprint;
+      t
+    
     method pprint (t: (symbol, termnode) term): string =
       match t with
         TermNode t -> t#pprint
@@ -1355,8 +1498,10 @@ and context () =
         begin
         match v#lookup_parent [s] vs with
           None ->
-          let node = new termnode (self :> context) s vs in
-          node
+          if !Stats.alloc_attribution then
+            Stats.with_alloc_subsystem Stats.AllocTermNodes (fun () -> new termnode (self :> context) s vs)
+          else
+            new termnode (self :> context) s vs
         | Some n -> n
         end
     
@@ -1669,57 +1814,111 @@ and context () =
       (* printff "Axiom (%s) %s asserted\n" (String.concat ", " (List.map self#pprint pats)) (self#pprint body); *)
       let triggeredCounter = ref 0 in
       axioms <- (description, triggeredCounter)::axioms;
+      (* The instances of this axiom in the current context, keyed by the E-graph classes bound to its variables. *)
+      let instances = Hashtbl.create 16 in
+      let instanceCount = ref 0 in
+      let instantiate bound_env =
+        let key = bound_env |> List.map (fun (i, t) -> (i, Oo.id t#value)) |> List.sort compare in
+        if Hashtbl.mem instances key then
+          duplicate_instantiation_count <- duplicate_instantiation_count + 1
+        else if !max_axiom_instantiations > 0 && !instanceCount >= !max_axiom_instantiations then begin
+          if verbosity >= 3 then trace "Redux: Axiom %s reached the instantiation limit" description;
+          limited_instantiation_count <- limited_instantiation_count + 1
+        end else begin
+          check_budget ();
+          Hashtbl.add instances key ();
+          incr instanceCount;
+          self#register_popaction (fun () -> Hashtbl.remove instances key; decr instanceCount);
+          incr triggeredCounter;
+          if verbosity >= 3 then trace "Redux: Axiom %s triggered" description;
+          if verbosity >= 4 then trace "Redux: Axiom %s triggered with" (self#pprint body);
+          let body = term_subst bound_env body in
+          if verbosity >= 4 then List.iter (fun (i, t) -> trace "            bound.%d = %s" i t#pprint) bound_env;
+          if !qi_profiling then begin
+            let longest c1 c2 = if List.length c2 > List.length c1 then c2 else c1 in
+            let cascade = description::List.fold_left (fun c (_, t) -> longest c t#qi_cascade) [] bound_env in
+            qi_record_instances description 1 (List.rev cascade);
+            self#add_redex (fun () ->
+              let cascade0 = qi_cascade in
+              qi_cascade <- cascade;
+              let time0 = Perf.time () in
+              let result = self#assume_core body in
+              qi_record_time description (Perf.time () -. time0);
+              qi_cascade <- cascade0;
+              result
+            )
+          end else
+            self#add_redex (fun () ->
+              (* printff "Asserting axiom body %s\n" (self#pprint body); *)
+              self#assume_core body
+            )
+        end
+      in
       pats |> List.iter (fun pat ->
         match pat with
           App (symb, args, _) ->
-          (* We ignore existing applications of this symbol for now. *)
-          symb#add_apply_listener (self :> context) (fun term ->
-            (* printff "Axiom %s: toplevel symbol listener triggered\n" (self#pprint body); *)
-            let rec match_pats bound_env oldvals pats cont =
-              match (oldvals, pats) with
-                ([], []) -> cont bound_env
-              | (oldval::oldvals, pat::pats) ->
-                match_pat bound_env oldval#initial_child#value pat (fun bound_env -> match_pats bound_env oldvals pats cont)
-            and match_pat bound_env value pat cont =
-              let term = value#initial_child in
-              match pat with
-                BoundVar i ->
-                begin match try_assoc i bound_env with
-                  None -> cont ((i, term)::bound_env)
-                | Some term' ->
-                  if term#value = term'#value then
-                    cont bound_env
-                  else
-                    term#value#add_merge_listener (fun () -> if term#value = term'#value then (cont bound_env; false) else true)
-                end
-              | App (symb, args, _) ->
-                let match_term term =
-                  if term#symbol = symb then
-                    match_pats bound_env term#children args cont
-                in
-                value#children |> List.iter match_term;
-                value#add_child_listener match_term
-              | NumLit n ->
-                let nnode = self#get_numnode n in
-                if nnode#value = term#value then
-                  cont bound_env
-                else
-                  term#value#add_merge_listener (fun () -> if term#value = nnode#value then (cont bound_env; false) else true)
-              | _ -> failwith (Printf.sprintf "Redux does not support subpattern %s; it currently supports only symbol applications and bound variables as subpatterns." (self#pprint pat))
-            in
-            match_pats [] term#children args (fun bound_env ->
-              incr triggeredCounter;
-              if verbosity >= 3 then trace "Redux: Axiom %s triggered" description;
-              if verbosity >= 4 then trace "Redux: Axiom %s triggered with" (self#pprint body);
-              let body = term_subst bound_env body in
-              if verbosity >= 4 then List.iter (fun (i, t) -> trace "            bound.%d = %s" i t#pprint) bound_env;
-              self#add_redex (fun () ->
-                (* printff "Asserting axiom body %s\n" (self#pprint body); *)
-                self#assume_core body
-              )
-            )
-          )
+          let args, renaming = normalize_trigger_args args in
+          self#add_trigger symb args (fun bound_env -> instantiate (List.map (fun (j, t) -> (List.assoc j renaming, t)) bound_env))
         | _ -> failwith "Redux supports only symbol applications at the top level of axiom triggers."
       )
+    method add_trigger symb args instantiate =
+      let key = Oo.id symb in
+      let triggers = try Hashtbl.find trigger_index key with Not_found -> [] in
+      let same_args (args', _) = List.length args = List.length args' && List.for_all2 pattern_equal args args' in
+      begin match try Some (List.find same_args triggers) with Not_found -> None with
+        Some (_, subscribers) ->
+        let subscribers0 = !subscribers in
+        subscribers := instantiate::subscribers0;
+        self#register_popaction (fun () -> subscribers := subscribers0)
+      | None ->
+        let subscribers = ref [instantiate] in
+        Hashtbl.replace trigger_index key ((args, subscribers)::triggers);
+        self#register_popaction (fun () -> Hashtbl.replace trigger_index key triggers);
+        symb#add_apply_listener (self :> context) (fun term ->
+          self#match_trigger args term (fun bound_env -> List.iter (fun instantiate -> instantiate bound_env) !subscribers)
+        )
+      end;
+      (* Terms that already exist are matched against the new subscriber only; the others have seen them already. *)
+      self#applications_of symb |> List.iter (fun term -> self#match_trigger args term instantiate)
+    method applications_of (symb: symbol) =
+      match symb#node with
+        Some node -> [node] (* Nullary symbols have a single node, which survives pops. *)
+      | None -> symb#applications
+    (* Calls [cont] with each binding of the bound variables of [args] for which [term] matches the trigger, either now or
+       as soon as the necessary equalities become known. *)
+    method match_trigger args (term: termnode) cont =
+      let rec match_pats bound_env oldvals pats cont =
+        match (oldvals, pats) with
+          ([], []) -> cont bound_env
+        | (oldval::oldvals, pat::pats) ->
+          match_pat bound_env oldval#initial_child#value pat (fun bound_env -> match_pats bound_env oldvals pats cont)
+      and match_pat bound_env value pat cont =
+        let term = value#initial_child in
+        match pat with
+          BoundVar i ->
+          begin match try_assoc i bound_env with
+            None -> cont ((i, term)::bound_env)
+          | Some term' ->
+            if term#value = term'#value then
+              cont bound_env
+            else
+              term#value#add_merge_listener (fun () -> if term#value = term'#value then (cont bound_env; false) else true)
+          end
+        | App (symb, args, _) ->
+          let match_term term =
+            if term#symbol = symb then
+              match_pats bound_env term#children args cont
+          in
+          value#children |> List.iter match_term;
+          value#add_child_listener match_term
+        | NumLit n ->
+          let nnode = self#get_numnode n in
+          if nnode#value = term#value then
+            cont bound_env
+          else
+            term#value#add_merge_listener (fun () -> if term#value = nnode#value then (cont bound_env; false) else true)
+        | _ -> failwith (Printf.sprintf "Redux does not support subpattern %s; it currently supports only symbol applications and bound variables as subpatterns." (self#pprint pat))
+      in
+      match_pats [] term#children args cont
     method simplify (t: (symbol, termnode) term): ((symbol, termnode) term) option = None
   end
@@ -453,6 +453,12 @@ module type STATEMENT = sig
   val pop : int -> t
   val comment : string -> t
   val check_sat : t
+  (* [define_fun f body] defines [f] as [body], in which the
+     parameters are named x0, x1, ... The body is given as text, so
+     that it can use operations that have no term in this module, such
+     as the conversions between integers and bit-vectors. The
+     definition requires the "BV" feature. *)
+  val define_fun : symbol -> string -> t
 
   val features : t -> string list
 end
@@ -479,6 +485,7 @@ module Statement
     | Pop of int
     | Comment of string
     | CheckSat
+    | DefineFun of symbol * string
 
   let set_logic s = SetLogic s
   let declare_sort s = SortDecl s
@@ -490,6 +497,10 @@ module Statement
     else Pop i
   let comment s = Comment s
   let check_sat = CheckSat
+  let define_fun f body = DefineFun (f, body)
+
+  let params f =
+    List.mapi (fun i sort -> Printf.sprintf "(x%d %s)" i (S.to_string sort)) (Sy.get_domain f)
 
   let print o : t -> unit = function
     | SetLogic s ->
@@ -511,6 +522,12 @@ module Statement
     | Comment s ->
        Format.fprintf o "; %s" s
     | CheckSat -> print_string o "(check-sat)"
+    | DefineFun (f, body) ->
+       Format.fprintf o "@[<3>(define-fun@ %a@ (%s)@ %a@ %s)@]"
+          Sy.print f
+          (String.concat " " (params f))
+          S.print (Sy.get_range f)
+          body
 
   let to_string = function
     | SetLogic s ->
@@ -531,6 +548,12 @@ module Statement
     | Comment s ->
        Printf.sprintf "; %s\n" s
     | CheckSat -> "(check-sat)"
+    | DefineFun (f, body) ->
+       Printf.sprintf "(define-fun %s (%s) %s %s)"
+          (Sy.to_string f)
+          (String.concat " " (params f))
+          (S.to_string (Sy.get_range f))
+          body
 
   let features = function
     | SetLogic _ | Comment _ | CheckSat -> []
@@ -538,6 +561,7 @@ module Statement
     | Assert t -> T.features t
     | SortDecl s -> S.features s
     | FunDecl f -> Sy.features f
+    | DefineFun (f, _) -> "BV" :: Sy.features f
 
 end
 
@@ -553,3 +577,4 @@ let push = St.push
 let pop = St.pop
 let comment = St.comment
 let check_sat = St.check_sat
+let define_fun = St.define_fun
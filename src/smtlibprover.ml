@@ -16,12 +16,25 @@ open Proverapi
 
 class smtlib_context input_fun output (features : string list) =
   let statements : Smtlib.statement list ref = ref [] in
-  let dump_fmt = Format.formatter_of_out_channel output in
+  (* Statements are buffered and only written out when we need an
+     answer from the solver, so that a query costs a single write
+     instead of a flush per declaration and assertion. *)
+  let buffer = Buffer.create 65536 in
+  let dump_fmt = Format.formatter_of_buffer buffer in
   let add_statement st =
     Format.fprintf dump_fmt "%a@\n" Smtlib.print_statement st;
-    flush output;
     statements := st :: !statements
   in
+  let flush_statements () =
+    Format.pp_print_flush dump_fmt ();
+    Buffer.output_buffer output buffer;
+    Buffer.clear buffer;
+    flush output
+  in
+  let read_answer () =
+    flush_statements ();
+    input_fun ()
+  in
   let has_features l =
     List.for_all (fun f -> List.mem f features) l
   in
@@ -72,7 +85,7 @@ class smtlib_context input_fun output (features : string list) =
     match !last_prover_answer with
     | None ->
        add_statement Smtlib.check_sat;
-       input_fun ()
+       read_answer ()
     | Some ans -> ans
   in
   let add_assert t =
@@ -84,16 +97,32 @@ class smtlib_context input_fun output (features : string list) =
       end
   in
   let assert_term t = add_assert t; check () in
+  (* The pop is written along with the check-sat, so that the whole
+     push/pop block is sent in one write. *)
+  let add_query t =
+    add_statement Smtlib.push;
+    add_statement (Smtlib.sassert (Smtlib.tnot t));
+    add_statement Smtlib.check_sat;
+    add_statement (Smtlib.pop 1)
+  in
   let query t =
     if has_features (Smtlib.T.features t) then
       begin
-        add_statement Smtlib.push;
-        let result = assert_term (Smtlib.tnot t) = Unsat in
-        add_statement (Smtlib.pop 1);
-        result
+        add_query t;
+        read_answer () = Unsat
       end
     else false   (* Same as an "unknown" answer *)
   in
+  (* The blocks of all queries are sent before the first answer is
+     read, so that the batch costs a single round trip. *)
+  let query_all ts =
+    List.for_all (fun t -> has_features (Smtlib.T.features t)) ts &&
+    begin
+      List.iter add_query ts;
+      flush_statements ();
+      List.fold_left (fun result _ -> let answer = input_fun () in result && answer = Unsat) true ts
+    end
+  in
   let assume_is_inverse f1 f2 dom2 =
     let x = Smtlib.mk_var 0 dom2 in
     let vx = Smtlib.var x in
@@ -101,6 +130,31 @@ class smtlib_context input_fun output (features : string list) =
     let app2 = Smtlib.app f1 [ app1 ] in
     add_assert (Smtlib.forall [ x ] [ app1 ] (Smtlib.eq app2 vx))
   in
+  (* Bitwise operations on integers of a given width are defined
+     through Z3's conversions between integers and bit-vectors, which
+     are not part of the SMTLib standard; hence the "BV" feature. *)
+  let bitwise_func (op, signed, width) =
+    let name = match op with BvAnd -> "bvand" | BvOr -> "bvor" | BvXor -> "bvxor" in
+    let f = Smtlib.fresh_symbol (Printf.sprintf "%s_%s%d" name (if signed then "int" else "uint") width) [ int_type; int_type ] int_type in
+    let bv x = Printf.sprintf "((_ int2bv %d) %s)" width x in
+    let r = Printf.sprintf "(%s %s %s)" name (bv "x0") (bv "x1") in
+    let body =
+      if signed then
+        Printf.sprintf "(let ((r %s)) (ite (bvslt r (_ bv0 %d)) (- (bv2nat r) %s) (bv2nat r)))"
+          r width (Big_int.string_of_big_int (Big_int.power_int_positive_int 2 width))
+      else
+        Printf.sprintf "(bv2nat %s)" r
+    in
+    maybe_add_statement (Smtlib.define_fun f body);
+    f
+  in
+  let bitwise_funcs = Hashtbl.create 10 in
+  let bitwise_func key =
+    try Hashtbl.find bitwise_funcs key with Not_found ->
+      let f = bitwise_func key in
+      Hashtbl.add bitwise_funcs key f;
+      f
+  in
   let boxed_int = declare_fun "box_int" [ int_type ] inductive_type in
   let unboxed_int = declare_fun "unbox_int" [ inductive_type ] int_type in
   let () = assume_is_inverse unboxed_int boxed_int int_type in
@@ -199,6 +253,10 @@ class smtlib_context input_fun output (features : string list) =
         cs
 
     method mk_app = Smtlib.app
+    method mk_bitwise op signed width t1 t2 =
+      if has_features [ "BV" ] then
+        Some (Smtlib.app (bitwise_func (op, signed, width)) [ t1; t2 ])
+      else None
     method mk_true = ttrue
     method mk_false = tfalse
     method mk_and = Smtlib.tand
@@ -240,6 +298,10 @@ class smtlib_context input_fun output (features : string list) =
       add_statement
         (Smtlib.comment (Printf.sprintf "Query: %s" (Smtlib.T.to_string t)));
       query t
+    method query_all ts =
+      let ts = List.map (fun t -> t ()) ts in
+      List.iter (fun t -> add_statement (Smtlib.comment (Printf.sprintf "Query: %s" (Smtlib.T.to_string t)))) ts;
+      query_all ts
     method assume t =
       add_statement
         (Smtlib.comment (Printf.sprintf "Assume: %s" (Smtlib.T.to_string t)));
@@ -267,23 +329,35 @@ class smtlib_context input_fun output (features : string list) =
         let quant = (Smtlib.forall (List.mapi Smtlib.mk_var tps) triggers body) in
         add_assert quant
    method simplify (t : Smtlib.term) = Some t
+   method flush = flush_statements ()
   end
 
 let dump_smtlib_ctxt filename features =
-  (new smtlib_context
-     (fun _ -> Unknown)
-     (open_out filename)
-     features
-   : smtlib_context :> (Smtlib.sort, Smtlib.symbol, Smtlib.term) context)
+  let ctxt =
+    new smtlib_context
+      (fun _ -> Unknown)
+      (open_out filename)
+      features
+  in
+  (* Statements added after the last check-sat are still buffered. *)
+  at_exit (fun () -> ctxt#flush);
+  (ctxt : smtlib_context :> (Smtlib.sort, Smtlib.symbol, Smtlib.term) context)
 
+(* The VERIFAST_SMTLIB_SOLVER environment variable overrides the
+   solver command, e.g. to run the tests against a stand-in solver. *)
 let external_smtlib_ctxt command features =
+  let command =
+    match Sys.getenv_opt "VERIFAST_SMTLIB_SOLVER" with
+      Some c -> c
+    | None -> command
+  in
   let (input, output) = Unix.open_process command in
   (new smtlib_context
      (fun _ ->
        match input_line input with
        | "unsat" -> Unsat
-       | "unknown" -> Unknown
-       | _ -> assert false)
+       | "sat" | "unknown" -> Unknown
+       | answer -> failwith ("Unexpected answer from the SMT solver: " ^ answer))
      output
      features
    : smtlib_context :> (Smtlib.sort, Smtlib.symbol, Smtlib.term) context)
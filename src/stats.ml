@@ -5,6 +5,231 @@ open Ast
 
 let parsing_stopwatch = Stopwatch.create ()
 
+(* Peak resident set size of this process in kB, as reported by Linux in /proc/self/status; None on other platforms. *)
+let peak_rss_kb () =
+  match (try Some (open_in "/proc/self/status") with Sys_error _ -> None) with
+    None -> None
+  | Some chan ->
+    let rec find () =
+      let line = input_line chan in
+      if String.length line > 6 && String.sub line 0 6 = "VmHWM:" then
+        Scanf.sscanf (String.sub line 6 (String.length line - 6)) " %d" (fun kb -> Some kb)
+      else
+        find ()
+    in
+    let result = try find () with End_of_file | Scanf.Scan_failure _ | Failure _ -> None in
+    close_in chan;
+    result
+
+(* Garbage collector statistics, reported by -stats. The collector's counters are sampled at the start and end of each
+   phase; a phase that is entered again while it is active (for example, checking a header included by a header) is
+   counted once. *)
+
+type gc_counters = {
+  mutable gc_allocated_words: float; (* Words allocated in the minor or major heap; promotions are not counted twice. *)
+  mutable gc_promoted_words: float;
+  mutable gc_minor_collections: int;
+  mutable gc_major_collections: int;
+  mutable gc_compactions: int
+}
+
+type gc_phase = {
+  gc_phase_counters: gc_counters;
+  mutable gc_phase_depth: int;
+  mutable gc_phase_start: Gc.stat option
+}
+
+let new_gc_phase () =
+  {gc_phase_counters = {gc_allocated_words = 0.0; gc_promoted_words = 0.0; gc_minor_collections = 0; gc_major_collections = 0; gc_compactions = 0}; gc_phase_depth = 0; gc_phase_start = None}
+
+let gc_phase_parsing = new_gc_phase ()
+let gc_phase_headers = new_gc_phase ()
+let gc_phase_functions = new_gc_phase ()
+
+let gc_phases = ["parsing", gc_phase_parsing; "headerChecking", gc_phase_headers; "functionBodies", gc_phase_functions]
+
+let allocated_words (s: Gc.stat) = s.Gc.minor_words +. s.Gc.major_words -. s.Gc.promoted_words
+
+let with_gc_phase phase f =
+  if phase.gc_phase_depth = 0 then phase.gc_phase_start <- Some (Gc.quick_stat ());
+  phase.gc_phase_depth <- phase.gc_phase_depth + 1;
+  let stop () =
+    phase.gc_phase_depth <- phase.gc_phase_depth - 1;
+    match phase.gc_phase_start with
+      Some s0 when phase.gc_phase_depth = 0 ->
+      let s1 = Gc.quick_stat () in
+      let c = phase.gc_phase_counters in
+      c.gc_allocated_words <- c.gc_allocated_words +. allocated_words s1 -. allocated_words s0;
+      c.gc_promoted_words <- c.gc_promoted_words +. s1.Gc.promoted_words -. s0.Gc.promoted_words;
+      c.gc_minor_collections <- c.gc_minor_collections + s1.Gc.minor_collections - s0.Gc.minor_collections;
+      c.gc_major_collections <- c.gc_major_collections + s1.Gc.major_collections - s0.Gc.major_collections;
+      c.gc_compactions <- c.gc_compactions + s1.Gc.compactions - s0.Gc.compactions;
+      phase.gc_phase_start <- None
+    | _ -> ()
+  in
+  match f () with
+    result -> stop (); result
+  | exception e -> stop (); raise e
+
+(* Attribution of minor heap allocation to subsystems, enabled by -stats. Allocation is charged to the innermost
+   subsystem being executed; code in continuation-passing style passes its continuation a wrapper that switches back to
+   the caller's subsystem. *)
+
+type alloc_subsystem = AllocOther | AllocLexer | AllocTermNodes | AllocHeapChunks
+
+let alloc_attribution = ref false
+let alloc_subsystems = [AllocLexer, "lexer"; AllocTermNodes, "termNodes"; AllocHeapChunks, "heapChunks"; AllocOther, "other"]
+let alloc_words: (alloc_subsystem, float ref) Hashtbl.t = Hashtbl.create 4
+let () = alloc_subsystems |> List.iter (fun (s, _) -> Hashtbl.add alloc_words s (ref 0.0))
+let alloc_current = ref AllocOther
+let alloc_last_minor_words = ref 0.0
+
+let start_alloc_attribution () =
+  alloc_attribution := true;
+  alloc_last_minor_words := Gc.minor_words ()
+
+let current_alloc_subsystem () = !alloc_current
+
+(* Charges the allocation since the previous switch to the current subsystem, and makes [s] current. *)
+let switch_alloc_subsystem s =
+  let w = Gc.minor_words () in
+  let total = Hashtbl.find alloc_words !alloc_current in
+  total := !total +. (w -. !alloc_last_minor_words);
+  alloc_last_minor_words := w;
+  alloc_current := s
+
+let with_alloc_subsystem s f =
+  if not !alloc_attribution || s == !alloc_current then f () else begin
+    let outer = !alloc_current in
+    switch_alloc_subsystem s;
+    match f () with
+      result -> switch_alloc_subsystem outer; result
+    | exception e -> switch_alloc_subsystem outer; raise e
+  end
+
+(* Verification profiling, enabled by vfconsole's -profile options. Wall time, prover time, prover queries, branches and
+   chunk matching attempts are attributed to the innermost with_context frame being executed, both per source line and
+   per stack of frames. Since symbolic execution is in continuation-passing style, a stack of frames is a prefix of an
+   execution path rather than a call stack. *)
+
+let profiling = ref false
+
+type profile_counters = {
+  mutable profile_self_time: float; (* Seconds spent in this frame, excluding nested frames but including prover calls *)
+  mutable profile_prover_time: float;
+  mutable profile_prover_queries: int;
+  mutable profile_branches: int;
+  mutable profile_chunk_matches: int
+}
+
+type profile_frame = {
+  profile_frame_label: string;
+  profile_frame_line: (string * int) option;
+  profile_frame_counters: profile_counters;
+  profile_frame_children: (string, profile_frame) Hashtbl.t
+}
+
+let new_profile_counters () =
+  {profile_self_time = 0.0; profile_prover_time = 0.0; profile_prover_queries = 0; profile_branches = 0; profile_chunk_matches = 0}
+
+let new_profile_frame label line =
+  {profile_frame_label = label; profile_frame_line = line; profile_frame_counters = new_profile_counters (); profile_frame_children = Hashtbl.create 4}
+
+let profile_root = new_profile_frame "verifast" None
+let profile_stack = ref [profile_root]
+let profile_lines: (string * int, profile_counters) Hashtbl.t = Hashtbl.create 1000
+let profile_last_time = ref 0.0
+
+let start_profiling () =
+  profiling := true;
+  profile_last_time := Perf.time ()
+
+let profile_update f =
+  match !profile_stack with
+    [] -> ()
+  | frame::_ ->
+    f frame.profile_frame_counters;
+    match frame.profile_frame_line with
+      None -> ()
+    | Some line ->
+      let counters =
+        try
+          Hashtbl.find profile_lines line
+        with Not_found ->
+          let counters = new_profile_counters () in
+          Hashtbl.add profile_lines line counters;
+          counters
+      in
+      f counters
+
+(* Attributes the time elapsed since the previous profiling event to the current frame. *)
+let profile_charge_time () =
+  let now = Perf.time () in
+  let dt = now -. !profile_last_time in
+  profile_last_time := now;
+  profile_update (fun c -> c.profile_self_time <- c.profile_self_time +. dt)
+
+let profile_push_frame (((path, line, _), _): loc0) =
+  if !profiling then begin
+    profile_charge_time ();
+    match !profile_stack with
+      [] -> ()
+    | parent::_ ->
+      let label = Printf.sprintf "%s:%d" (Filename.basename path) line in
+      let frame =
+        try
+          Hashtbl.find parent.profile_frame_children label
+        with Not_found ->
+          let frame = new_profile_frame label (Some (path, line)) in
+          Hashtbl.add parent.profile_frame_children label frame;
+          frame
+      in
+      profile_stack := frame::!profile_stack
+  end
+
+let profile_pop_frame () =
+  if !profiling then begin
+    profile_charge_time ();
+    match !profile_stack with
+      _::(_::_ as stack) -> profile_stack := stack
+    | _ -> ()
+  end
+
+let profile_prover_call f =
+  if not !profiling then f () else begin
+    let t0 = Perf.time () in
+    let record () =
+      let dt = Perf.time () -. t0 in
+      profile_update (fun c -> c.profile_prover_time <- c.profile_prover_time +. dt; c.profile_prover_queries <- c.profile_prover_queries + 1)
+    in
+    match f () with
+      result -> record (); result
+    | exception e -> record (); raise e
+  end
+
+let profile_chunk_match () =
+  if !profiling then profile_update (fun c -> c.profile_chunk_matches <- c.profile_chunk_matches + 1)
+
+(* The per-line counters, in decreasing order of self time. *)
+let profile_line_counters () =
+  profile_charge_time ();
+  Hashtbl.fold (fun line counters acc -> (line, counters)::acc) profile_lines []
+  |> List.sort (fun (_, c1) (_, c2) -> compare c2.profile_self_time c1.profile_self_time)
+
+(* Writes the self time of each stack of frames, in microseconds, in the folded stack format read by flame graph tools. *)
+let profile_write_folded_stacks filename =
+  profile_charge_time ();
+  let sanitize s = String.map (fun c -> if c = ';' || c = '\n' then ' ' else c) s in
+  let chan = open_out_bin filename in
+  let rec iter stack frame =
+    let stack = if stack = "" then frame.profile_frame_label else stack ^ ";" ^ sanitize frame.profile_frame_label in
+    let us = int_of_float (frame.profile_frame_counters.profile_self_time *. 1e6) in
+    if us > 0 then output_string chan (stack ^ " " ^ string_of_int us ^ "\n");
+    Hashtbl.iter (fun _ child -> iter stack child) frame.profile_frame_children
+  in
+  iter "" profile_root;
+  close_out chan
+
 class stats =
   object (self)
     val startTime = Perf.time()
@@ -16,13 +241,20 @@ class stats =
     val mutable stmtExecLocs = Hashtbl.create 1000;
     val mutable execStepCount = 0
     val mutable branchCount = 0
+    val mutable mergedBranchCount = 0
     val mutable proverAssumeCount = 0
     val mutable definitelyEqualSameTermCount = 0
     val mutable definitelyEqualQueryCount = 0
     val mutable proverOtherQueryCount = 0
+    val mutable overflowChecksDischargedLocallyCount = 0
+    val mutable overflowChecksByProverCount = 0
+    val mutable ruleAttemptCount = 0
+    val mutable ruleHitCount = 0
+    val mutable ruleFailureCachedCount = 0
     val mutable proverStats = ""
     val mutable overhead: <path: string; nonghost_lines: int; ghost_lines: int; mixed_lines: int> list = []
     val mutable functionTimings: (string * float) list = []
+    val mutable functionAllocations: (string * float) list = [] (* Words *)
     
     method tickLength = let t1 = Perf.time() in let ticks1 = Stopwatch.processor_ticks() in (t1 -. startTime) /. Int64.to_float (Int64.sub ticks1 startTicks)
 
@@ -36,11 +268,17 @@ class stats =
     method getStmtExecLocs = Hashtbl.fold (fun _ loc locs -> loc::locs) stmtExecLocs []
     method getStmtExecOnAllPaths = stmtExecOnAllPathsCount
     method execStep = execStepCount <- execStepCount + 1
-    method branch = branchCount <- branchCount + 1
+    method branch = branchCount <- branchCount + 1; if !profiling then profile_update (fun c -> c.profile_branches <- c.profile_branches + 1)
+    method mergedBranch = mergedBranchCount <- mergedBranchCount + 1
     method proverAssume = proverAssumeCount <- proverAssumeCount + 1
     method definitelyEqualSameTerm = definitelyEqualSameTermCount <- definitelyEqualSameTermCount + 1
     method definitelyEqualQuery = definitelyEqualQueryCount <- definitelyEqualQueryCount + 1
     method proverOtherQuery = proverOtherQueryCount <- proverOtherQueryCount + 1
+    method overflowCheckDischargedLocally = overflowChecksDischargedLocallyCount <- overflowChecksDischargedLocallyCount + 1
+    method overflowCheckByProver = overflowChecksByProverCount <- overflowChecksByProverCount + 1
+    method ruleAttempt = ruleAttemptCount <- ruleAttemptCount + 1
+    method ruleHit = ruleHitCount <- ruleHitCount + 1
+    method ruleFailureCached = ruleFailureCachedCount <- ruleFailureCachedCount + 1
     method appendProverStats (text, tickCounts) =
       let tickLength = self#tickLength in
       proverStats <- proverStats ^ text ^ String.concat "" (List.map (fun (lbl, ticks) -> Printf.sprintf "%s: %.6fs\n" lbl (Int64.to_float ticks *. tickLength)) tickCounts)
@@ -48,12 +286,56 @@ class stats =
       let o = object method path = path method nonghost_lines = nonGhostLineCount method ghost_lines = ghostLineCount method mixed_lines = mixedLineCount end in
       overhead <- o::overhead
     method recordFunctionTiming funName seconds = if seconds > 0.1 then functionTimings <- (funName, seconds)::functionTimings
+    method recordFunctionAllocation funName words = if words > 1e6 then functionAllocations <- (funName, words)::functionAllocations
     method getFunctionTimings =
       let compare (_, t1) (_, t2) = compare t1 t2 in
       let timingsSorted = List.sort compare functionTimings in
       let max_funName_length = List.fold_left (fun m (n, _) -> max m (String.length n)) 0 timingsSorted in
       String.concat "" (List.map (fun (funName, seconds) -> Printf.sprintf "  %-*s: %6.2f seconds\n" max_funName_length funName seconds) timingsSorted)
     
+    (* Machine-readable counters, reported by vfconsole -json -stats and consumed by vfbench. *)
+    method getCounters =
+      [
+        "statementsVerified", float_of_int self#getStmtExec;
+        "execSteps", float_of_int execStepCount;
+        "branches", float_of_int branchCount;
+        "mergedBranches", float_of_int mergedBranchCount;
+        "proverAssumes", float_of_int proverAssumeCount;
+        "equalityQueries", float_of_int definitelyEqualQueryCount;
+        "otherProverQueries", float_of_int proverOtherQueryCount;
+        "overflowChecksDischargedLocally", float_of_int overflowChecksDischargedLocallyCount;
+        "overflowChecksByProver", float_of_int overflowChecksByProverCount;
+        "autoRuleAttempts", float_of_int ruleAttemptCount;
+        "autoRuleHits", float_of_int ruleHitCount;
+        "autoRuleFailuresCached", float_of_int ruleFailureCachedCount;
+        "totalTime", Perf.time() -. startTime
+      ] @
+      begin
+        let s = Gc.quick_stat () in
+        [
+          "gcAllocatedWords", allocated_words s;
+          "gcPromotedWords", s.Gc.promoted_words;
+          "gcMinorCollections", float_of_int s.Gc.minor_collections;
+          "gcMajorCollections", float_of_int s.Gc.major_collections;
+          "gcCompactions", float_of_int s.Gc.compactions;
+          "gcTopHeapWords", float_of_int s.Gc.top_heap_words
+        ]
+      end @
+      (gc_phases |> flatmap begin fun (name, {gc_phase_counters=c}) ->
+         [
+           name ^ "AllocatedWords", c.gc_allocated_words;
+           name ^ "PromotedWords", c.gc_promoted_words;
+           name ^ "MajorCollections", float_of_int c.gc_major_collections
+         ]
+       end) @
+      (if not !alloc_attribution then [] else begin
+       switch_alloc_subsystem !alloc_current;
+       alloc_subsystems |> List.map (fun (s, name) -> (name ^ "MinorWords", !(Hashtbl.find alloc_words s)))
+       end) @
+      match peak_rss_kb () with
+        None -> []
+      | Some kb -> ["peakRssKb", float_of_int kb]
+
     method printStats =
       print_endline ("Syntactic annotation overhead statistics:");
       let max_path_size = List.fold_left (fun m o -> max m (String.length o#path)) 0 overhead in
@@ -70,19 +352,51 @@ class stats =
       print_endline ("Statement executions: " ^ string_of_int (self#getStmtExec));
       print_endline ("Execution steps (including assertion production/consumption steps): " ^ string_of_int execStepCount);
       print_endline ("Symbolic execution forks: " ^ string_of_int branchCount);
+      print_endline ("Symbolic execution forks avoided by joining branches: " ^ string_of_int mergedBranchCount);
       print_endline ("Prover assumes: " ^ string_of_int proverAssumeCount);
       print_endline ("Term equality tests -- same term: " ^ string_of_int definitelyEqualSameTermCount);
       print_endline ("Term equality tests -- prover query: " ^ string_of_int definitelyEqualQueryCount);
       print_endline ("Term equality tests -- total: " ^ string_of_int (definitelyEqualSameTermCount + definitelyEqualQueryCount));
       print_endline ("Other prover queries: " ^ string_of_int proverOtherQueryCount);
+      print_endline ("Overflow checks discharged by interval analysis: " ^ string_of_int overflowChecksDischargedLocallyCount);
+      print_endline ("Overflow checks sent to the prover: " ^ string_of_int overflowChecksByProverCount);
+      print_endline ("Automation rule attempts: " ^ string_of_int ruleAttemptCount);
+      print_endline ("Automation rule hits: " ^ string_of_int ruleHitCount);
+      print_endline ("Automation rule attempts skipped after an earlier failure: " ^ string_of_int ruleFailureCachedCount);
       print_endline ("Prover statistics:\n" ^ proverStats);
       Printf.printf "Time spent parsing: %.6fs\n" (Int64.to_float (Stopwatch.ticks parsing_stopwatch) *. self#tickLength);
       print_endline ("Function timings (> 0.1s):\n" ^ self#getFunctionTimings);
+      let s = Gc.quick_stat () in
+      let mwords w = w /. 1e6 in
+      print_endline "Garbage collector statistics (allocation in millions of words):";
+      Printf.printf "  %-26s: allocated: %10.2f; promoted: %10.2f; minor GCs: %6d; major GCs: %4d; compactions: %2d\n"
+        "total" (mwords (allocated_words s)) (mwords s.Gc.promoted_words) s.Gc.minor_collections s.Gc.major_collections s.Gc.compactions;
+      [gc_phase_parsing, "parsing"; gc_phase_headers, "checking headers"; gc_phase_functions, "verifying function bodies"] |> List.iter begin fun ({gc_phase_counters=c}, name) ->
+        Printf.printf "  %-26s: allocated: %10.2f; promoted: %10.2f; minor GCs: %6d; major GCs: %4d; compactions: %2d\n"
+          name (mwords c.gc_allocated_words) (mwords c.gc_promoted_words) c.gc_minor_collections c.gc_major_collections c.gc_compactions
+      end;
+      Printf.printf "  Largest major heap: %.2f million words\n" (mwords (float_of_int s.Gc.top_heap_words));
+      if !alloc_attribution then begin
+        switch_alloc_subsystem !alloc_current;
+        print_endline "Minor heap allocation by subsystem (millions of words):";
+        alloc_subsystems |> List.iter (fun (s, name) -> Printf.printf "  %-12s: %10.2f\n" name (mwords !(Hashtbl.find alloc_words s)))
+      end;
+      let allocationsSorted = List.sort (fun (_, w1) (_, w2) -> compare w2 w1) functionAllocations in
+      print_endline "Function allocations (> 1 million words):";
+      allocationsSorted |> List.iter (fun (funName, words) -> Printf.printf "  %s: %.2f million words\n" funName (mwords words));
+      begin match peak_rss_kb () with
+        None -> ()
+      | Some kb -> Printf.printf "Peak resident set size: %d kB\n" kb
+      end;
       print_endline (Printf.sprintf "Total time: %.2f seconds" (Perf.time() -. startTime))
   end
 
 let stats = ref (new stats)
 
 let clear_stats _ = 
-  stats := (new stats)
+  stats := (new stats);
+  gc_phases |> List.iter (fun (_, {gc_phase_counters=c}) ->
+    c.gc_allocated_words <- 0.0; c.gc_promoted_words <- 0.0; c.gc_minor_collections <- 0; c.gc_major_collections <- 0; c.gc_compactions <- 0);
+  Hashtbl.iter (fun _ total -> total := 0.0) alloc_words;
+  alloc_last_minor_words := Gc.minor_words ()
   
@@ -0,0 +1,193 @@
+(* Streaming trace log, written by vfconsole -trace and read by vftrace.
+
+   While tracing, the verifier writes each execution tree node, each prover call and the symbolic execution context of
+   each error to the log as soon as it is produced, instead of building the execution tree in memory. The log is a
+   sequence of records, each starting with a tag character:
+
+     'T' id string                        Defines string [id]; later records refer to paths and messages by id.
+     'X' id parent path line col msg      An execution node (a symbolic execution step) below node [parent].
+     'S' parent                           A path that ends in success.
+     'E' parent path line col msg n ctxt* A path that ends in an error, with its n context entries, innermost first.
+     'Q' parent kind term result          A prover call: kind 0 is an assume, 1 a query.
+
+   Integers are unsigned LEB128 varints; strings that are not interned are a varint length followed by the bytes. The
+   root of the tree has id 0. *)
+
+type srcpos = string * int * int
+
+type trace_context =
+  CtxtAssuming of string
+| CtxtExecuting of string list (* heap chunks *) * (string * string) list (* environment *) * srcpos * string
+| CtxtPushSubcontext
+| CtxtPopSubcontext
+| CtxtBranching of bool (* left branch? *)
+
+type prover_call = AssumeCall | QueryCall
+
+type event =
+  ExecNode of int * int * srcpos * string (* id, parent, location, message *)
+| SuccessNode of int (* parent *)
+| ErrorNode of int * srcpos * string * trace_context list (* parent, location, message, context *)
+| ProverCallNode of int * prover_call * string * string (* parent, kind, term, result *)
+
+let magic = "VFTRACE1\n"
+
+(* Region: writing *)
+
+let tracing = ref false
+let chan = ref stdout
+let current_node = ref 0
+let node_count = ref 0
+let interned: (string, int) Hashtbl.t = Hashtbl.create 1000
+
+let rec output_varint n =
+  if n < 0x80 then
+    output_byte !chan n
+  else begin
+    output_byte !chan (n land 0x7f lor 0x80);
+    output_varint (n lsr 7)
+  end
+
+let output_bytes s =
+  output_varint (String.length s);
+  output_string !chan s
+
+(* Interned strings must be defined before the record that refers to them. *)
+let define s =
+  if not (Hashtbl.mem interned s) then begin
+    let id = Hashtbl.length interned in
+    Hashtbl.add interned s id;
+    output_char !chan 'T';
+    output_varint id;
+    output_bytes s
+  end
+
+let output_srcpos (path, line, col) =
+  output_varint (Hashtbl.find interned path);
+  output_varint line;
+  output_varint col
+
+let start filename =
+  chan := open_out_bin filename;
+  output_string !chan magic;
+  tracing := true;
+  at_exit (fun () -> if !tracing then begin tracing := false; close_out !chan end)
+
+(* Writes an execution node below the current node and returns its id. The caller makes it the current node. *)
+let exec_node ((path, _, _) as pos) msg =
+  define path;
+  define msg;
+  incr node_count;
+  let id = !node_count in
+  output_char !chan 'X';
+  output_varint id;
+  output_varint !current_node;
+  output_srcpos pos;
+  output_varint (Hashtbl.find interned msg);
+  id
+
+let success_node () =
+  output_char !chan 'S';
+  output_varint !current_node
+
+let error_node ((path, _, _) as pos) msg ctxts =
+  define path;
+  ctxts |> List.iter (function CtxtExecuting (_, _, (path, _, _), msg) -> define path; define msg | _ -> ());
+  output_char !chan 'E';
+  output_varint !current_node;
+  output_srcpos pos;
+  output_bytes msg;
+  output_varint (List.length ctxts);
+  ctxts |> List.iter begin function
+    CtxtAssuming t -> output_char !chan 'A'; output_bytes t
+  | CtxtExecuting (h, env, pos, msg) ->
+    output_char !chan 'X';
+    output_varint (List.length h);
+    List.iter output_bytes h;
+    output_varint (List.length env);
+    List.iter (fun (x, v) -> output_bytes x; output_bytes v) env;
+    output_srcpos pos;
+    output_varint (Hashtbl.find interned msg)
+  | CtxtPushSubcontext -> output_char !chan 'P'
+  | CtxtPopSubcontext -> output_char !chan 'O'
+  | CtxtBranching left -> output_char !chan (if left then 'L' else 'R')
+  end;
+  (* Errors are rare and are what the log is read for; make sure they survive a crash. *)
+  flush !chan
+
+let prover_call kind term result =
+  output_char !chan 'Q';
+  output_varint !current_node;
+  output_varint (match kind with AssumeCall -> 0 | QueryCall -> 1);
+  output_bytes term;
+  output_bytes result
+
+(* Region: reading *)
+
+exception Corrupt_trace of string
+
+(* Calls [f] on each event of the trace log in [filename], in the order in which they were written. *)
+let iter_events filename f =
+  let chan = open_in_bin filename in
+  let strings: (int, string) Hashtbl.t = Hashtbl.create 1000 in
+  let rec input_varint () =
+    let b = input_byte chan in
+    if b < 0x80 then b else (b land 0x7f) lor (input_varint () lsl 7)
+  in
+  let input_bytes () = really_input_string chan (input_varint ()) in
+  let input_interned () =
+    let id = input_varint () in
+    match Hashtbl.find_opt strings id with
+      Some s -> s
+    | None -> raise (Corrupt_trace (Printf.sprintf "undefined string %d" id))
+  in
+  let input_srcpos () = let path = input_interned () in let line = input_varint () in let col = input_varint () in (path, line, col) in
+  let rec input_list n read = if n = 0 then [] else let x = read () in x::input_list (n - 1) read in
+  let input_context () =
+    match input_char chan with
+      'A' -> CtxtAssuming (input_bytes ())
+    | 'X' ->
+      let h = input_list (input_varint ()) input_bytes in
+      let env = input_list (input_varint ()) (fun () -> let x = input_bytes () in let v = input_bytes () in (x, v)) in
+      let pos = input_srcpos () in
+      let msg = input_interned () in
+      CtxtExecuting (h, env, pos, msg)
+    | 'P' -> CtxtPushSubcontext
+    | 'O' -> CtxtPopSubcontext
+    | 'L' -> CtxtBranching true
+    | 'R' -> CtxtBranching false
+    | c -> raise (Corrupt_trace (Printf.sprintf "unknown context tag %C" c))
+  in
+  let finally () = close_in chan in
+  try
+    if really_input_string chan (String.length magic) <> magic then raise (Corrupt_trace "not a VeriFast trace log");
+    let rec iter () =
+      match input_char chan with
+        exception End_of_file -> ()
+      | 'T' -> let id = input_varint () in Hashtbl.replace strings id (input_bytes ()); iter ()
+      | 'X' ->
+        let id = input_varint () in
+        let parent = input_varint () in
+        let pos = input_srcpos () in
+        let msg = input_interned () in
+        f (ExecNode (id, parent, pos, msg)); iter ()
+      | 'S' -> f (SuccessNode (input_varint ())); iter ()
+      | 'E' ->
+        let parent = input_varint () in
+        let pos = input_srcpos () in
+        let msg = input_bytes () in
+        let ctxts = input_list (input_varint ()) input_context in
+        f (ErrorNode (parent, pos, msg, ctxts)); iter ()
+      | 'Q' ->
+        let parent = input_varint () in
+        let kind = match input_varint () with 0 -> AssumeCall | _ -> QueryCall in
+        let term = input_bytes () in
+        let result = input_bytes () in
+        f (ProverCallNode (parent, kind, term, result)); iter ()
+      | c -> raise (Corrupt_trace (Printf.sprintf "unknown record tag %C" c))
+    in
+    iter ();
+    finally ()
+  with
+    End_of_file -> finally (); raise (Corrupt_trace "truncated trace log")
+  | e -> finally (); raise e
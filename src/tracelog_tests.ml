@@ -0,0 +1,44 @@
+open Tracelog
+
+let () =
+  let filename = Filename.temp_file "tracelog_tests" ".bin" in
+  start filename;
+  let n1 = exec_node ("a.c", 3, 5) "Executing statement" in
+  current_node := n1;
+  prover_call AssumeCall "0 <= x" "unknown";
+  let n2 = exec_node ("a.c", 4, 5) "Executing statement" in
+  current_node := n2;
+  success_node ();
+  current_node := n1;
+  let n3 = exec_node ("b.h", 300, 1) "Verifying call" in
+  current_node := n3;
+  prover_call QueryCall "x < 1000" "false";
+  let ctxts = [CtxtExecuting (["p(x)"; "q(0, \"\\n\")"], ["x", "x"], ("b.h", 300, 1), "Verifying call"); CtxtBranching false; CtxtAssuming "0 <= x"; CtxtPushSubcontext; CtxtPopSubcontext] in
+  error_node ("b.h", 300, 1) "Cannot prove x < 1000." ctxts;
+  close_out !chan;
+  tracing := false;
+  let events = ref [] in
+  iter_events filename (fun e -> events := e::!events);
+  Sys.remove filename;
+  assert (List.rev !events = [
+    ExecNode (1, 0, ("a.c", 3, 5), "Executing statement");
+    ProverCallNode (1, AssumeCall, "0 <= x", "unknown");
+    ExecNode (2, 1, ("a.c", 4, 5), "Executing statement");
+    SuccessNode 2;
+    ExecNode (3, 1, ("b.h", 300, 1), "Verifying call");
+    ProverCallNode (3, QueryCall, "x < 1000", "false");
+    ErrorNode (3, ("b.h", 300, 1), "Cannot prove x < 1000.", ctxts)
+  ])
+
+let () =
+  (* A log cut off in the middle of a record yields the complete records before it. *)
+  let filename = Filename.temp_file "tracelog_tests" ".bin" in
+  let chan = open_out_bin filename in
+  output_string chan magic;
+  output_string chan "T\000\003a.cT\001\001mX\001\000\000\002\003\001X\002\001";
+  close_out chan;
+  let events = ref [] in
+  let result = try iter_events filename (fun e -> events := e::!events); None with Corrupt_trace msg -> Some msg in
+  Sys.remove filename;
+  assert (result = Some "truncated trace log");
+  assert (!events = [ExecNode (1, 0, ("a.c", 2, 3), "m")])
@@ -14,7 +14,7 @@ open Verify_expr
 
 exception FileNotFound of string
 
-let merge_file_options prover0 options {disable_overflow_check; prover; target} =
+let merge_file_options prover0 options {disable_overflow_check; bitvectors; prover; target} =
   (match prover with None -> prover0 | Some prover -> prover),
   {
     options with
@@ -23,6 +23,11 @@ let merge_file_options prover0 options {disable_overflow_check; prover; target}
           None -> options.option_disable_overflow_check
         | Some b -> b
         end;
+      option_bitvectors=
+        begin match bitvectors with
+          None -> options.option_bitvectors
+        | Some b -> b
+        end;
       option_data_model=
         match target with
           None -> options.option_data_model
@@ -65,6 +70,9 @@ module VerifyProgram(VerifyProgramArgs: VERIFY_PROGRAM_ARGS) = struct
   
   include VerifyExpr(VerifyProgramArgs)
   
+  (** The names in option -verify_only for which a body was found. *)
+  let verify_only_found = ref []
+  
   module CheckFile(CheckFileArgs: CHECK_FILE_ARGS) = struct
   
   include CheckFile_VerifyExpr(CheckFileArgs)
@@ -148,9 +156,51 @@ module VerifyProgram(VerifyProgramArgs: VERIFY_PROGRAM_ARGS) = struct
   
   let varargs__pred = lazy_predfamsymb "varargs_"
 
+  (* With -join_branches, an if statement whose branches only assign constants or other locals to locals is executed
+     without forking: each assigned local gets the value (if cond then v1 else v2). Branches that do anything else are
+     still executed separately, since merging them would require joining heaps. Returns the locations of the assignments,
+     the assigned locals and the environment after the branch, or None if the branch is not of this form. *)
+  let assignment_only_branch tenv ghostenv env ss =
+    let local_type x =
+      match try_assoc x tenv with
+        None | Some (RefType _) -> None
+      | Some t -> if List.mem x ghostenv then None else Some t
+    in
+    let rec iter locs xs env ss =
+      match ss with
+        [] -> Some (locs, xs, env)
+      | BlockStmt (_, [], ss0, _, _)::ss ->
+        begin match iter locs xs env ss0 with
+          None -> None
+        | Some (locs, xs, env) -> iter locs xs env ss
+        end
+      | (ExprStmt (AssignExpr (_, Var (_, x), rhs)) as s)::ss ->
+        begin match local_type x with
+          None -> None
+        | Some t ->
+          let v =
+            match rhs, unfold_inferred_type t with
+              Var (_, y), _ when local_type y = Some t -> try_assoc y env
+            | IntLit (_, n, _, _, _), (Int (signedness, rank) as t) ->
+              (* Int, long and pointer-sized integers are at least two bytes wide under every data model. *)
+              let t = match rank with LitRank _ -> t | _ -> Int (signedness, LitRank 1) in
+              if is_within_limits n t then Some (term_of_big_int n) else None
+            | True _, Bool -> Some ctxt#mk_true
+            | False _, Bool -> Some ctxt#mk_false
+            | _ -> None
+          in
+          match v with
+            None -> None
+          | Some v -> iter (stmt_loc s::locs) (if List.mem x xs then xs else x::xs) ((x, v)::env) ss
+        end
+      | _ -> None
+    in
+    iter [] [] env ss
+
   let rec verify_stmt (pn,ilist) blocks_done lblenv tparams boxes pure leminfo funcmap predinstmap sizemap tenv ghostenv h env s tcont return_cont econt =
     let l = stmt_loc s in
     if not (is_transparent_stmt s) then begin !stats#stmtExec l; reportStmtExec l end;
+    if !Proverapi.qi_profiling then Proverapi.qi_source := string_of_loc l;
     let break_label () = if pure then "#ghostBreak" else "#break" in
     let free_locals closeBraceLoc h tenv env locals cont =
       let rec free_locals_core h locals =
@@ -796,7 +846,27 @@ module VerifyProgram(VerifyProgramArgs: VERIFY_PROGRAM_ARGS) = struct
       end;
       let w = check_condition (pn,ilist) tparams tenv e in
       let tcont _ _ _ h env = tcont sizemap tenv ghostenv h (List.filter (fun (x, _) -> List.mem_assoc x tenv) env) in
+      let joined_env env w =
+        if not join_branches || pure then None else
+        match assignment_only_branch tenv ghostenv env ss1, assignment_only_branch tenv ghostenv env ss2 with
+          Some (locs1, xs1, env1), Some (locs2, xs2, env2) ->
+          let xs = xs1 @ List.filter (fun x -> not (List.mem x xs1)) xs2 in
+          begin match
+            flatmap (fun x -> match try_assoc x env1, try_assoc x env2 with Some v1, Some v2 -> [(x, v1, v2)] | _ -> []) xs
+          with
+            bindings when List.length bindings = List.length xs ->
+            Some (locs1 @ locs2, List.map (fun (x, v1, v2) -> (x, if v1 == v2 then v1 else ctxt#mk_ifthenelse w v1 v2)) bindings @ env)
+          | _ -> None
+          end
+        | _ -> None
+      in
       (eval_h_nonpure h env w ( fun h env w ->
+        match joined_env env w with
+          Some (locs, env) ->
+          !stats#mergedBranch;
+          List.iter (fun l -> !stats#stmtExec l; reportStmtExec l) locs;
+          tcont sizemap tenv ghostenv h env
+        | None ->
         branch
           (fun _ -> assume w (fun _ -> verify_block (pn,ilist) blocks_done lblenv tparams boxes pure leminfo funcmap predinstmap sizemap tenv ghostenv h env ss1 tcont return_cont econt))
           (fun _ -> assume (ctxt#mk_not w) (fun _ -> verify_block (pn,ilist) blocks_done lblenv tparams boxes pure leminfo funcmap predinstmap sizemap tenv ghostenv h env ss2 tcont return_cont econt))
@@ -2217,7 +2287,7 @@ module VerifyProgram(VerifyProgramArgs: VERIFY_PROGRAM_ARGS) = struct
     match ss with
       [] -> cont sizemap tenv ghostenv h env
     | s::ss ->
-      with_context (Executing (h, env, stmt_loc s, "Executing statement")) (fun _ ->
+      in_context (Executing (h, env, stmt_loc s, "Executing statement")) (fun _ ->
         verify_stmt (pn,ilist) blocks_done lblenv tparams boxes pure leminfo funcmap predinstmap sizemap tenv ghostenv h env s (fun sizemap tenv ghostenv h env ->
           verify_cont (pn,ilist) blocks_done lblenv tparams boxes pure leminfo funcmap predinstmap sizemap tenv ghostenv h env ss cont return_cont econt
         ) return_cont econt
@@ -2951,8 +3021,10 @@ module VerifyProgram(VerifyProgramArgs: VERIFY_PROGRAM_ARGS) = struct
   
   let record_fun_timing l funName body =
     let time0 = Perf.time() in
-    let result = body () in
+    let gcStat0 = Gc.quick_stat () in
+    let result = with_gc_phase gc_phase_functions body in
     !stats#recordFunctionTiming (string_of_loc l ^ ": " ^ funName) (Perf.time() -. time0);
+    !stats#recordFunctionAllocation (string_of_loc l ^ ": " ^ funName) (allocated_words (Gc.quick_stat ()) -. allocated_words gcStat0);
     result
   
   let rec verify_exceptional_return (pn,ilist) l h ghostenv env exceptp excep handlers =
@@ -2977,6 +3049,13 @@ module VerifyProgram(VerifyProgramArgs: VERIFY_PROGRAM_ARGS) = struct
     else
       success()
   
+  (** Whether to verify the body known by any of the names [gs]; see option -verify_only. *)
+  let verify_body gs =
+    verify_only = [] ||
+    match List.filter (fun g -> List.mem g verify_only) gs with
+      [] -> false
+    | found -> verify_only_found := found @ !verify_only_found; true
+  
   let rec verify_cons (pn,ilist) cfin cn supercn superctors boxes lems cons tparams =
     let thisType = ObjType (cn, (List.map (fun tparam -> RealTypeParam tparam) tparams)) in
     match cons with
@@ -2989,8 +3068,11 @@ module VerifyProgram(VerifyProgramArgs: VERIFY_PROGRAM_ARGS) = struct
           verify_cons (pn,ilist) cfin cn supercn superctors boxes lems rest tparams
         else
           static_error lm "Constructor specification is only allowed in javaspec files!" None
+      | Some (Some _) when not (verify_body [cn ^ ".<ctor>"]) ->
+        verify_cons (pn,ilist) cfin cn supercn superctors boxes lems rest tparams
       | Some (Some ((ss, closeBraceLoc), rank)) ->
         if report_skipped_stmts || match pre with ExprAsn (_, False _) -> false | _ -> true then reportStmts ss;
+        ignore @@ with_function_budget lm (cn ^ ".<ctor>") begin fun () ->
         record_fun_timing lm (cn ^ ".<ctor>") begin fun () ->
         if !verbosity >= 1 then Printf.printf "%10.6fs: %s: Verifying constructor %s\n" (Perf.time()) (string_of_loc lm) (string_of_sign (cn, sign));
         execute_branch begin fun () ->
@@ -3070,10 +3152,11 @@ module VerifyProgram(VerifyProgramArgs: VERIFY_PROGRAM_ARGS) = struct
           assume_neq this (ctxt#mk_intlit 0) $. fun() -> do_body h ghostenv (("this", this)::env)
         end
         end
+        end
         end;
         verify_cons (pn,ilist) cfin cn supercn superctors boxes lems rest tparams
 
-  let rec verify_meths (pn,ilist) cfin cabstract boxes lems meths ctparams=
+  let rec verify_meths (pn,ilist) cfin cabstract cn boxes lems meths ctparams=
     match meths with
       [] -> ()
     | ((g, sign), MethodInfo (l, gh, rt, ps, pre, pre_tenv, post, epost, pre_dyn, post_dyn, epost_dyn, terminates, sts, fb, v, _, abstract, mtparams))::meths ->
@@ -3086,10 +3169,13 @@ module VerifyProgram(VerifyProgramArgs: VERIFY_PROGRAM_ARGS) = struct
       if abstract && not cabstract then static_error l "Abstract method can only appear in abstract class." None;
       match sts with
         None -> let ((p,_,_),(_,_,_))= root_caller_token l in 
-          if (Filename.check_suffix p ".javaspec") || abstract then verify_meths (pn,ilist) cfin cabstract boxes lems meths ctparams
+          if (Filename.check_suffix p ".javaspec") || abstract then verify_meths (pn,ilist) cfin cabstract cn boxes lems meths ctparams
           else static_error l "Method specification is only allowed in javaspec files!" None
+      | Some (Some _) when not (verify_body [cn ^ "." ^ g; g]) ->
+        verify_meths (pn,ilist) cfin cabstract cn boxes lems meths ctparams
       | Some (Some ((ss, closeBraceLoc), rank)) ->
         if report_skipped_stmts || match pre with ExprAsn (_, False _) -> false | _ -> true then reportStmts ss;
+        ignore @@ with_function_budget l g begin fun () ->
         record_fun_timing l g begin fun () ->
         if !verbosity >= 1 then Printf.printf "%10.6fs: %s: Verifying method %s\n" (Perf.time()) (string_of_loc l) g;
         if abstract then static_error l "Abstract method cannot have implementation." None;
@@ -3135,8 +3221,9 @@ module VerifyProgram(VerifyProgramArgs: VERIFY_PROGRAM_ARGS) = struct
           let cont sizemap tenv ghostenv h env = return_cont h tenv env None in
           verify_block (pn, ilist) [] [] allTparams boxes in_pure_context leminfo funcmap predinstmap sizemap tenv ghostenv h env ss cont return_cont econt
         end
+        end
         end;
-        verify_meths (pn, ilist) cfin cabstract boxes lems meths ctparams
+        verify_meths (pn, ilist) cfin cabstract cn boxes lems meths ctparams
   
   let rec verify_classes boxes lems classm=
     match classm with
@@ -3149,7 +3236,7 @@ module VerifyProgram(VerifyProgramArgs: VERIFY_PROGRAM_ARGS) = struct
       in
       if superfinal = FinalClass then static_error cl "Cannot extend final class." None;
       verify_cons (cpn, cilist) cfinal cn csuper superctors boxes lems cctors ctpenv;
-      verify_meths (cpn, cilist) cfinal cabstract boxes lems cmeths ctpenv;
+      verify_meths (cpn, cilist) cfinal cabstract cn boxes lems cmeths ctpenv;
       verify_classes boxes lems classm
   
   let rec verify_funcs (pn,ilist)  boxes gs lems ds =
@@ -3182,15 +3269,26 @@ module VerifyProgram(VerifyProgramArgs: VERIFY_PROGRAM_ARGS) = struct
           gs
       in
       verify_funcs (pn,ilist) boxes gs lems ds
+    | Func (l, k, _, _, g, _, _, functype_opt, _, _, Some _, _, _)::ds when k <> Fixpoint && not (verify_body [full_name pn g]) ->
+      let g = full_name pn g in
+      let gs', lems' = if is_lemma k then (gs, g::lems) else (g::gs, lems) in
+      verify_funcs (pn, ilist) boxes gs' lems' ds
     | Func (l, k, _, _, g, _, _, functype_opt, _, _, Some _, _, _)::ds when k <> Fixpoint ->
       let g = full_name pn g in
-      let gs', lems' =
+      let result =
+      with_function_budget l g begin fun () ->
       record_fun_timing l g begin fun () ->
       let FuncInfo ([], fterm, l, k, tparams', rt, ps, nonghost_callers_only, pre, pre_tenv, post, terminates, _, Some (Some (ss, closeBraceLoc)),fb,v) = (List.assoc g funcmap)in
       let tparams = [] in
       let env = [] in
       verify_func pn ilist gs lems boxes predinstmap funcmap tparams env l k tparams' rt g ps nonghost_callers_only pre pre_tenv post terminates ss closeBraceLoc
+      end
       end in
+      let gs', lems' =
+        match result with
+          Some (gs', lems') -> (gs', lems')
+        | None -> if is_lemma k then (gs, g::lems) else (g::gs, lems)
+      in
       verify_funcs (pn, ilist) boxes gs' lems' ds
     | BoxClassDecl (l, bcn, _, _, _, _)::ds -> let bcn=full_name pn bcn in
       let (Some (l, boxpmap, boxinv, boxvarmap, amap, hpmap)) = try_assoc' Ghost (pn,ilist) bcn boxmap in
@@ -3283,21 +3381,29 @@ module VerifyProgram(VerifyProgramArgs: VERIFY_PROGRAM_ARGS) = struct
            List.iter (fun (an, _) -> if not (List.mem an pbcans) then static_error l ("No preserved_by clause for action '" ^ an ^ "'.") None) amap)
         hpmap;
       verify_funcs (pn,ilist) (bcn::boxes) gs lems ds
+    | CxxCtor (loc, mangled_name, _, _, _, Some _, _, StructType sn) :: ds when not (verify_body [sn ^ ".<ctor>"]) ->
+      verify_funcs (pn, ilist) boxes (mangled_name::gs) lems ds
     | CxxCtor (loc, mangled_name, _, _, _, Some _, _, StructType sn) :: ds ->
-      let gs', lems' =
+      let result =
+        with_function_budget loc (sn ^ ".<ctor>") @@ fun () ->
         record_fun_timing loc (sn ^ ".<ctor>") @@ fun () ->
         let _, Some (_, fields), _, _ = List.assoc sn structmap in
         let loc, params, pre, pre_tenv, post, terminates, Some (Some (init_list, (body, close_brace_loc))) = List.assoc mangled_name cxx_ctor_map1 in
         verify_cxx_ctor pn ilist gs lems boxes predinstmap funcmap (sn, fields, mangled_name, loc, params, init_list, pre, pre_tenv, post, terminates, body, close_brace_loc)
       in
+      let gs', lems' = match result with Some (gs', lems') -> (gs', lems') | None -> (mangled_name::gs, lems) in
       verify_funcs (pn, ilist) boxes gs' lems' ds
+    | CxxDtor (loc, _, _, Some _, _, StructType sn) :: ds when not (verify_body [sn ^ ".<dtor>"]) ->
+      verify_funcs (pn, ilist) boxes (cxx_dtor_name sn::gs) lems ds
     | CxxDtor (loc, _, _, Some _, _, StructType sn) :: ds ->
-      let gs', lems' =
+      let result =
+        with_function_budget loc (sn ^ ".<dtor>") @@ fun () ->
         record_fun_timing loc (sn ^ ".<dtor>") @@ fun () ->
         let _, Some (bases, fields), _, _ = List.assoc sn structmap in
         let loc, pre, pre_tenv, post, terminates, Some (Some (body, close_brace_loc)) = List.assoc sn cxx_dtor_map1 in 
         verify_cxx_dtor pn ilist gs lems boxes predinstmap funcmap (sn, bases, fields, cxx_dtor_name sn, loc, pre, pre_tenv, post, terminates, body, close_brace_loc)
       in
+      let gs', lems' = match result with Some (gs', lems') -> (gs', lems') | None -> (cxx_dtor_name sn::gs, lems) in
       verify_funcs (pn, ilist) boxes gs' lems' ds
     | _::ds -> verify_funcs (pn,ilist)  boxes gs lems ds
   
@@ -3437,6 +3543,11 @@ module VerifyProgram(VerifyProgramArgs: VERIFY_PROGRAM_ARGS) = struct
         [] -> ()
       | l::_ -> static_error (Lexed l) "No error found on line." None
     end;
+    begin
+      match List.filter (fun g -> not (List.mem g !verify_only_found)) verify_only with
+        [] -> ()
+      | g::_ -> static_error (Lexed (file_loc path)) (Printf.sprintf "No function, method or constructor named '%s' has a body in this program." g) None
+    end;
     result
   
   let () =
@@ -3581,6 +3692,73 @@ There are 7 kinds of entries possible in a vfmanifest/dll_vfmanifest file
   
 end
 
+(** Delegates to prover context [ctxt], adding each assume and query to the profile and the trace log. Queries in a
+    query_all batch are sent one by one, so that each is recorded. Only used while profiling or tracing. *)
+class ['typenode, 'symbol, 'termnode] instrumented_context (ctxt: ('typenode, 'symbol, 'termnode) Proverapi.context) =
+  object (self)
+    method set_verbosity = ctxt#set_verbosity
+    method type_bool = ctxt#type_bool
+    method type_int = ctxt#type_int
+    method type_real = ctxt#type_real
+    method type_inductive = ctxt#type_inductive
+    method mk_boxed_int = ctxt#mk_boxed_int
+    method mk_unboxed_int = ctxt#mk_unboxed_int
+    method mk_boxed_real = ctxt#mk_boxed_real
+    method mk_unboxed_real = ctxt#mk_unboxed_real
+    method mk_boxed_bool = ctxt#mk_boxed_bool
+    method mk_unboxed_bool = ctxt#mk_unboxed_bool
+    method mk_symbol = ctxt#mk_symbol
+    method set_fpclauses = ctxt#set_fpclauses
+    method mk_app = ctxt#mk_app
+    method mk_true = ctxt#mk_true
+    method mk_false = ctxt#mk_false
+    method mk_and = ctxt#mk_and
+    method mk_or = ctxt#mk_or
+    method mk_not = ctxt#mk_not
+    method mk_ifthenelse = ctxt#mk_ifthenelse
+    method mk_iff = ctxt#mk_iff
+    method mk_implies = ctxt#mk_implies
+    method mk_eq = ctxt#mk_eq
+    method mk_intlit = ctxt#mk_intlit
+    method mk_intlit_of_string = ctxt#mk_intlit_of_string
+    method mk_add = ctxt#mk_add
+    method mk_sub = ctxt#mk_sub
+    method mk_mul = ctxt#mk_mul
+    method mk_div = ctxt#mk_div
+    method mk_mod = ctxt#mk_mod
+    method mk_lt = ctxt#mk_lt
+    method mk_le = ctxt#mk_le
+    method mk_reallit = ctxt#mk_reallit
+    method mk_reallit_of_num = ctxt#mk_reallit_of_num
+    method mk_real_add = ctxt#mk_real_add
+    method mk_real_sub = ctxt#mk_real_sub
+    method mk_real_mul = ctxt#mk_real_mul
+    method mk_real_lt = ctxt#mk_real_lt
+    method mk_real_le = ctxt#mk_real_le
+    method pprint = ctxt#pprint
+    method pprint_sort = ctxt#pprint_sort
+    method pprint_sym = ctxt#pprint_sym
+    method push = ctxt#push
+    method pop = ctxt#pop
+    method assert_term = ctxt#assert_term
+    method assume t =
+      let result = Stats.profile_prover_call (fun () -> ctxt#assume t) in
+      if !Tracelog.tracing then Tracelog.prover_call Tracelog.AssumeCall (ctxt#pprint t) (Proverapi.string_of_assume_result result);
+      result
+    method query t =
+      let result = Stats.profile_prover_call (fun () -> ctxt#query t) in
+      if !Tracelog.tracing then Tracelog.prover_call Tracelog.QueryCall (ctxt#pprint t) (string_of_bool result);
+      result
+    method query_all ts = List.for_all (fun t -> self#query (t ())) ts
+    method mk_bitwise = ctxt#mk_bitwise
+    method stats = ctxt#stats
+    method begin_formal = ctxt#begin_formal
+    method end_formal = ctxt#end_formal
+    method mk_bound = ctxt#mk_bound
+    method assume_forall = ctxt#assume_forall
+    method simplify = ctxt#simplify
+  end
+
 (** Verifies the .c/.jarsrc/.scala file at path [path].
     Uses the SMT solver [ctxt].
     Reports syntax highlighting regions using the callback [reportRange] in [callbacks].
@@ -3602,7 +3780,11 @@ let verify_program_core (* ?verify_program_core *)
     type typenode = typenode'
     type symbol = symbol'
     type termnode = termnode'
-    let ctxt = ctxt
+    let ctxt =
+      if !Stats.profiling || !Tracelog.tracing then
+        (new instrumented_context ctxt :> (typenode', symbol', termnode') Proverapi.context)
+      else
+        ctxt
     let options = options
     let program_path = program_path
     let callbacks = callbacks
@@ -135,6 +135,9 @@ let string_of_context c =
 
 exception SymbolicExecutionError of string context list * loc * string * string option
 
+(** A per-function time or memory budget was exceeded; carries the symbolic execution context at that point. *)
+exception FunctionBudgetExceeded of string context list * string
+
 let full_name pn n = if pn = "" then n else pn ^ "." ^ n
 
 (* prepends '~' to the given record name *)
@@ -161,6 +164,13 @@ type options = {
   option_allow_undeclared_struct_types: bool;
   option_data_model: data_model option;
   option_report_skipped_stmts: bool; (* Report statements in functions or methods that have no contract. *)
+  option_verify_only: string list; (* If nonempty, verify only the bodies of the functions with these names. *)
+  option_list_theory: bool; (* Assume some list.gh lemmas about append, nth and reverse as axioms. *)
+  option_bitvectors: bool; (* Also define the results of bitwise operators on fixed-width integers through the prover's bit-vector theory, if it has one. *)
+  option_join_branches: bool; (* Execute an if statement whose branches only assign constants or locals to locals without forking. *)
+  option_function_timeout: float option; (* Give up on a function body after this many seconds and continue with the next one. *)
+  option_function_memory_limit: int option; (* Give up on a function body once the heap has grown by this many megabytes during its verification. *)
+  option_function_max_depth: int option; (* Give up on a function body once symbolic execution is nested this many contexts deep. *)
 } (* ?options *)
 
 (* Region: verify_program_core: the toplevel function *)
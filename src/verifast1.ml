@@ -32,9 +32,10 @@ type callbacks = {
   reportStmt: loc0 -> unit;
   reportStmtExec: loc0 -> unit;
   reportDirective: string -> loc0 -> bool;
+  reportFunctionBudgetExceeded: loc -> string -> string context list -> string -> unit; (* Function location and name, context, message *)
 }
 
-let noop_callbacks = {reportRange = (fun _ _ -> ()); reportUseSite = (fun _ _ _ -> ()); reportExecutionForest = (fun _ -> ()); reportStmt = (fun _ -> ()); reportStmtExec = (fun _ -> ()); reportDirective = (fun _ _ -> false)}
+let noop_callbacks = {reportRange = (fun _ _ -> ()); reportUseSite = (fun _ _ _ -> ()); reportExecutionForest = (fun _ -> ()); reportStmt = (fun _ -> ()); reportStmtExec = (fun _ -> ()); reportDirective = (fun _ _ -> false); reportFunctionBudgetExceeded = (fun _ _ _ _ -> ())}
 
 module type VERIFY_PROGRAM_ARGS = sig
   val emitter_callback: package list -> unit
@@ -71,9 +72,16 @@ module VerifyProgram1(VerifyProgramArgs: VERIFY_PROGRAM_ARGS) = struct
     option_allow_undeclared_struct_types;
     option_data_model=data_model;
     option_report_skipped_stmts=report_skipped_stmts;
+    option_verify_only=verify_only;
+    option_list_theory=list_theory;
+    option_bitvectors=bitvectors;
+    option_join_branches=join_branches;
+    option_function_timeout=function_timeout;
+    option_function_memory_limit=function_memory_limit;
+    option_function_max_depth=function_max_depth;
   } = options
 
-  let {reportRange; reportUseSite; reportExecutionForest; reportStmt; reportStmtExec; reportDirective} = callbacks
+  let {reportRange; reportUseSite; reportExecutionForest; reportStmt; reportStmtExec; reportDirective; reportFunctionBudgetExceeded} = callbacks
 
   let reportUseSite dk ld lu =
     if ld <> DummyLoc && lu <> DummyLoc then
@@ -118,6 +126,28 @@ module VerifyProgram1(VerifyProgramArgs: VERIFY_PROGRAM_ARGS) = struct
   let dummy_frac_terms = ref []
   (** The terms that represent predicate constructor applications. *)
   let pred_ctor_applications : (termnode * (symbol * termnode * (termnode list) * int option)) list ref = ref []
+
+  module TermHashtbl = Hashtbl.Make(struct type t = termnode let equal = (==) let hash = Hashtbl.hash end)
+
+  (** Maps integer terms to an interval that contains their value on the current path. Used to discharge overflow checks without querying the prover. *)
+  let term_intervals: (big_int * big_int) TermHashtbl.t = TermHashtbl.create 10000
+  (** The previous intervals of the terms whose interval was changed since the last push() or [assume]. *)
+  let term_intervals_undo_stack = ref []
+
+  let interval_of_term t = TermHashtbl.find_opt term_intervals t
+
+  let set_term_interval t iv =
+    term_intervals_undo_stack := (t, interval_of_term t)::!term_intervals_undo_stack;
+    TermHashtbl.replace term_intervals t iv
+
+  let undo_term_intervals saved_undo_stack =
+    while !term_intervals_undo_stack != saved_undo_stack do
+      match !term_intervals_undo_stack with
+        (t, iv)::undo_stack ->
+        begin match iv with None -> TermHashtbl.remove term_intervals t | Some iv -> TermHashtbl.replace term_intervals t iv end;
+        term_intervals_undo_stack := undo_stack
+      | [] -> failwith "undo_term_intervals: undo stack underflow"
+    done
   (** When switching to the next symbolic execution branch, this stack is popped to forget about fresh identifiers generated in the old branch. *)
   let used_ids_stack = ref []
   
@@ -167,9 +197,25 @@ module VerifyProgram1(VerifyProgramArgs: VERIFY_PROGRAM_ARGS) = struct
   let register_pred_ctor_application t symbol symbol_term ts inputParamCount =
     pred_ctor_applications := (t, (symbol, symbol_term, ts, inputParamCount)) :: !pred_ctor_applications
 
+  let trace_srcpos l = match root_caller_token_opt l with Some l0 -> fst l0 | None -> dummy_srcpos
+  
+  let trace_context c =
+    match c with
+      Assuming t -> Tracelog.CtxtAssuming t
+    | Executing (h, env, l, msg) -> Tracelog.CtxtExecuting (List.map string_of_chunk h, env, trace_srcpos l, msg)
+    | PushSubcontext -> Tracelog.CtxtPushSubcontext
+    | PopSubcontext -> Tracelog.CtxtPopSubcontext
+    | Branching b -> Tracelog.CtxtBranching (b = LeftBranch)
+  
+  (* While tracing, execution tree nodes are written to the trace log instead of being added to the execution forest. *)
+  
   let assert_false h env l msg url =
-    push (Node (ErrorNode, ref [])) !currentForest;
-    raise (SymbolicExecutionError (pprint_context_stack !contextStack, l, msg, url))
+    let ctxts = pprint_context_stack !contextStack in
+    if !Tracelog.tracing then
+      Tracelog.error_node (trace_srcpos l) msg (List.map trace_context ctxts)
+    else
+      push (Node (ErrorNode, ref [])) !currentForest;
+    raise (SymbolicExecutionError (ctxts, l, msg, url))
   
   let push_node l msg =
     let oldPath, oldBranch, oldTargetPath = !currentPath, !currentBranch, !targetPath in
@@ -188,16 +234,22 @@ module VerifyProgram1(VerifyProgramArgs: VERIFY_PROGRAM_ARGS) = struct
     currentPath := oldBranch::oldPath;
     currentBranch := 0;
     push_undo_item (fun () -> currentPath := oldPath; currentBranch := oldBranch + 1; targetPath := oldTargetPath);
-    let newForest = ref [] in
-    let oldForest = !currentForest in
-    push (Node (ExecNode (msg, !currentPath), newForest)) oldForest;
-    push_undo_item (fun () -> currentForest := oldForest);
-    currentForest := newForest
+    if !Tracelog.tracing then begin
+      let oldNode = !Tracelog.current_node in
+      Tracelog.current_node := Tracelog.exec_node (trace_srcpos l) msg;
+      push_undo_item (fun () -> Tracelog.current_node := oldNode)
+    end else begin
+      let newForest = ref [] in
+      let oldForest = !currentForest in
+      push (Node (ExecNode (msg, !currentPath), newForest)) oldForest;
+      push_undo_item (fun () -> currentForest := oldForest);
+      currentForest := newForest
+    end
   
   let success () = SymExecSuccess
 
   let major_success () =  (* A major success is a successful completion of a symbolic execution path that shows up as a green node in the execution tree. *)
-    push (Node (SuccessNode, ref [])) !currentForest;
+    if !Tracelog.tracing then Tracelog.success_node () else push (Node (SuccessNode, ref [])) !currentForest;
     success ()
 
   let push_context ?(verbosity_level=1) msg =
@@ -211,9 +263,11 @@ module VerifyProgram1(VerifyProgramArgs: VERIFY_PROGRAM_ARGS) = struct
   let pop_context () = let (h::t) = !contextStack in contextStack := t
   
   let contextStackStack = ref []
+  let contextStackDepth = ref 0 (* The length of contextStackStack *)
+  let max_contextStackDepth = ref max_int (* Set by with_function_budget if option -function_max_depth is given. *)
   
-  let push_contextStack () = push_undoStack(); contextStackStack := !contextStack::!contextStackStack
-  let pop_contextStack () = pop_undoStack(); let h::t = !contextStackStack in contextStack := h; contextStackStack := t
+  let push_contextStack () = push_undoStack(); contextStackStack := !contextStack::!contextStackStack; incr contextStackDepth
+  let pop_contextStack () = pop_undoStack(); let h::t = !contextStackStack in contextStack := h; contextStackStack := t; decr contextStackDepth
   
   let with_context_force msg cont =
     !stats#execStep;
@@ -223,37 +277,73 @@ module VerifyProgram1(VerifyProgramArgs: VERIFY_PROGRAM_ARGS) = struct
     pop_contextStack ();
     result
   
+  (* Raised before the push, so that the enclosing context reports it. *)
+  let check_depth () =
+    match function_max_depth with
+      Some n when !contextStackDepth >= !max_contextStackDepth -> raise (BudgetExceeded (Printf.sprintf "Symbolic execution depth limit (%d) exceeded" n))
+    | _ -> ()
+  
   let with_context ?(verbosity_level=1) msg cont =
     !stats#execStep;
+    check_budget ();
+    check_depth ();
     push_contextStack ();
     push_context ~verbosity_level msg;
-    do_finally
-      begin fun () ->
-        if !targetPath <> Some [] then
-          cont()
-        else
-          SymExecSuccess
-      end
-      pop_contextStack
+    let profile_frame =
+      if not !profiling then None else
+      match msg with
+        Executing (_, _, l, _) -> root_caller_token_opt l
+      | _ -> None
+    in
+    begin match profile_frame with None -> () | Some l0 -> profile_push_frame l0 end;
+    let finally () =
+      if profile_frame <> None then profile_pop_frame ();
+      pop_contextStack ()
+    in
+    match if !targetPath <> Some [] then cont() else SymExecSuccess with
+      result -> finally (); result
+    | exception BudgetExceeded msg ->
+      (* The innermost context reports the budget overrun, while the context stack is still intact. *)
+      let ctxts = pprint_context_stack !contextStack in
+      finally ();
+      raise (FunctionBudgetExceeded (ctxts, msg))
+    | exception e -> finally (); raise e
+  
+  (** Like [with_context], but calls [cont] in tail position, so that a sequence of statements or assertions does not
+      consume a native stack frame per element. The context and its undo items are dropped by the innermost enclosing
+      [with_context] or [pop] instead. Profile frames must be popped on return, so this falls back to [with_context]
+      while profiling. *)
+  let in_context ?(verbosity_level=1) msg cont =
+    if !profiling then with_context ~verbosity_level msg cont else begin
+      !stats#execStep;
+      check_budget ();
+      check_depth ();
+      push_context ~verbosity_level msg;
+      if !targetPath <> Some [] then cont() else SymExecSuccess
+    end
   
   (** Remember the current path condition, set of used IDs, and set of dummy fraction terms. *)  
   let push() =
-    used_ids_stack := (!used_ids_undo_stack, !dummy_frac_terms, !pred_ctor_applications)::!used_ids_stack;
+    used_ids_stack := (!used_ids_undo_stack, !dummy_frac_terms, !pred_ctor_applications, !term_intervals_undo_stack)::!used_ids_stack;
     used_ids_undo_stack := [];
     ctxt#push;
     push_contextStack ()
   
-  (** Restore the previous path condition, set of used IDs, and set of dummy fraction terms. *)
-  let pop() =
-    pop_contextStack ();
+  let pop_scope () =
     List.iter (fun r -> decr r) !used_ids_undo_stack;
-    let ((usedIdsUndoStack, dummyFracTerms, predCtorApplications)::t) = !used_ids_stack in
+    let ((usedIdsUndoStack, dummyFracTerms, predCtorApplications, termIntervalsUndoStack)::t) = !used_ids_stack in
+    undo_term_intervals termIntervalsUndoStack;
     used_ids_undo_stack := usedIdsUndoStack;
     dummy_frac_terms := dummyFracTerms;
     pred_ctor_applications := predCtorApplications;
     used_ids_stack := t;
     ctxt#pop
   
+  (** Restore the previous path condition, set of used IDs, and set of dummy fraction terms. *)
+  let pop() =
+    pop_contextStack ();
+    pop_scope ()
+  
   (** Execute [cont] in a temporary context. *)
   let in_temporary_context cont =
     push();
@@ -261,6 +351,35 @@ module VerifyProgram1(VerifyProgramArgs: VERIFY_PROGRAM_ARGS) = struct
     pop();
     r
   
+  (** Verify the body of function [g] by calling [cont] within the per-function time, memory and depth budgets, if any.
+      If a budget is exceeded, report it, restore the symbolic execution state and return [None], so that the caller can
+      continue with the next function. *)
+  let with_function_budget l g cont =
+    if function_timeout = None && function_memory_limit = None && function_max_depth = None then Some (cont ()) else
+    let scopeDepth = List.length !used_ids_stack in
+    let contextStackDepth0 = !contextStackDepth in
+    let contextStack0 = !contextStack in
+    let stop () =
+      stop_budget ();
+      max_contextStackDepth := max_int
+    in
+    let report ctxts msg =
+      stop ();
+      while List.length !used_ids_stack > scopeDepth do pop_scope () done;
+      while !contextStackDepth > contextStackDepth0 do pop_contextStack () done;
+      contextStack := contextStack0;
+      reportFunctionBudgetExceeded l g ctxts msg;
+      Gc.compact ();
+      None
+    in
+    if function_timeout <> None || function_memory_limit <> None then start_budget function_timeout function_memory_limit;
+    begin match function_max_depth with None -> () | Some n -> max_contextStackDepth := contextStackDepth0 + n end;
+    match cont () with
+      result -> stop (); Some result
+    | exception FunctionBudgetExceeded (ctxts, msg) -> report ctxts msg
+    | exception BudgetExceeded msg -> report (pprint_context_stack !contextStack) msg
+    | exception e -> stop (); raise e
+  
   let execute_branch cont =
     let SymExecSuccess = in_temporary_context cont in
     ()
@@ -526,11 +645,84 @@ module VerifyProgram1(VerifyProgramArgs: VERIFY_PROGRAM_ARGS) = struct
     | Int (Unsigned, LitRank k) -> le_big_int zero_big_int n && le_big_int n (max_unsigned_big_int k)
     | _ -> false
 
+  (* Region: integer intervals *)
+
+  (* To discharge overflow checks without querying the prover, integer terms are annotated with an interval that
+     contains their value (see term_intervals). Intervals come from the bounds of the type of a symbol, from literals,
+     and from the comparisons assumed on the current path; they are propagated through +, - and *. *)
+
+  type condition_operands =
+    Comparison of bool (* strict *) * termnode * termnode
+  | Conjunction of termnode * termnode
+
+  (** Maps a comparison or conjunction term to its operands, so that assuming it can refine their intervals. *)
+  let condition_operands: condition_operands TermHashtbl.t = TermHashtbl.create 1000
+
+  (* The smallest and largest rank an integer rank may denote under the data model; without a data model, the ranges
+     follow the sizes assumed for int, long and pointers (see int_size_term). *)
+  let rank_range rank =
+    match rank, data_model with
+      LitRank k, _ -> (k, k)
+    | IntRank, Some {int_rank} -> (int_rank, int_rank)
+    | LongRank, Some {long_rank} -> (long_rank, long_rank)
+    | PtrRank, Some {ptr_rank} -> (ptr_rank, ptr_rank)
+    | IntRank, None -> (1, 2)
+    | LongRank, None -> (2, 3)
+    | PtrRank, None -> (1, 3)
+
+  let interval_of_rank signedness k =
+    match signedness with
+      Signed -> (min_signed_big_int k, max_signed_big_int k)
+    | Unsigned -> (zero_big_int, max_unsigned_big_int k)
+
+  (** Returns an interval that contains all values of type [tp] (if [outer]) or that is contained in the values of [tp]. *)
+  let interval_of_type outer tp =
+    match int_rank_and_signedness tp with
+      None -> None
+    | Some (rank, signedness) ->
+      let (kmin, kmax) = rank_range rank in
+      Some (interval_of_rank signedness (if outer then kmax else kmin))
+
+  let interval_within (lo, hi) (lo', hi') = le_big_int lo' lo && le_big_int hi hi'
+
+  let interval_of_op op (lo1, hi1) (lo2, hi2) =
+    match op with
+      Add -> Some (add_big_int lo1 lo2, add_big_int hi1 hi2)
+    | Sub -> Some (sub_big_int lo1 hi2, sub_big_int hi1 lo2)
+    | Mul ->
+      let ps = [mult_big_int lo1 lo2; mult_big_int lo1 hi2; mult_big_int hi1 lo2; mult_big_int hi1 hi2] in
+      Some (List.fold_left min_big_int (List.hd ps) ps, List.fold_left max_big_int (List.hd ps) ps)
+    | _ -> None
+
+  (** Narrows the intervals of the operands of [t], assuming [t] holds. *)
+  let rec refine_term_intervals t =
+    match TermHashtbl.find_opt condition_operands t with
+      None -> ()
+    | Some (Conjunction (t1, t2)) -> refine_term_intervals t1; refine_term_intervals t2
+    | Some (Comparison (strict, t1, t2)) ->
+      (* t1 <= t2 - d *)
+      let d = if strict then unit_big_int else zero_big_int in
+      match interval_of_term t1, interval_of_term t2 with
+        Some (lo1, hi1), Some (lo2, hi2) ->
+        let hi1' = min_big_int hi1 (sub_big_int hi2 d) in
+        let lo2' = max_big_int lo2 (add_big_int lo1 d) in
+        if lt_big_int hi1' hi1 then set_term_interval t1 (lo1, hi1');
+        if gt_big_int lo2' lo2 then set_term_interval t2 (lo2', hi2)
+      | _ -> ()
+
+  let record_condition_operands t operands =
+    if TermHashtbl.length condition_operands > 100000 then TermHashtbl.reset condition_operands;
+    TermHashtbl.replace condition_operands t operands
+
   let assume_bounds term (tp: type_) = 
     match tp with
       Int (_, _)|PtrType _ ->
       let min, max = limits_of_type tp in
-      ctxt#assert_term (ctxt#mk_and (ctxt#mk_le min term) (ctxt#mk_le term max))
+      ctxt#assert_term (ctxt#mk_and (ctxt#mk_le min term) (ctxt#mk_le term max));
+      begin match interval_of_type true tp with
+        Some iv -> set_term_interval term iv
+      | None -> ()
+      end
     | _ -> ()
   
   let get_unique_var_symb_non_ghost x t = 
@@ -1126,7 +1318,7 @@ module VerifyProgram1(VerifyProgramArgs: VERIFY_PROGRAM_ARGS) = struct
                     (jarspecs, ds)
                 in
                 reportUseSite DeclKind_HeaderFile (Lexed ((path, 1, 1), (path, 1, 1))) l;
-                let (_, maps) = check_file header_path header_is_import_spec include_prelude (Filename.dirname path) headers' ds in
+                let (_, maps) = with_gc_phase gc_phase_headers (fun () -> check_file header_path header_is_import_spec include_prelude (Filename.dirname path) headers' ds) in
                 headermap := (path, (headers', maps))::!headermap;
                 (headers', maps)
               | Some (headers', maps) ->
@@ -1155,7 +1347,7 @@ module VerifyProgram1(VerifyProgramArgs: VERIFY_PROGRAM_ARGS) = struct
                 let rtdir = Filename.dirname rtpath in
                 let ds = Java_frontend_bridge.parse_java_files (List.map (fun x -> concat rtdir x) javaspecs) [] reportRange
                                                                reportShouldFail initial_verbosity enforce_annotations use_java_frontend in
-                let (_, maps0) = check_file rtpath true false !bindir [] ds in
+                let (_, maps0) = with_gc_phase gc_phase_headers (fun () -> check_file rtpath true false !bindir [] ds) in
                 headermap := (rtpath, ([], maps0))::!headermap;
                 (maps0, [])
               | Some ([], maps0) ->
@@ -5699,6 +5891,48 @@ module VerifyProgram1(VerifyProgramArgs: VERIFY_PROGRAM_ARGS) = struct
   let prover_convert_term term t t0 =
     if t = t0 then term else convert_provertype term (provertype_of_type t) (provertype_of_type t0)
 
+  (* Region: ground values *)
+
+  (* The concrete values of the terms built from literals and inductive constructors. Applications of fixpoint
+     functions to such terms are evaluated by eval_ground_fixpoint_app instead of by the prover. Boxing is
+     transparent: a boxed term has the same ground value as the term it boxes. *)
+  type ground_value =
+    GInt of big_int
+  | GBool of bool
+  | GCtor of string (* full constructor name *) * ground_value list
+
+  let ground_values: ground_value TermHashtbl.t = TermHashtbl.create 10000
+
+  let ground_value_of_term t = TermHashtbl.find_opt ground_values t
+
+  let set_ground_value t gv =
+    if TermHashtbl.length ground_values > 100000 then TermHashtbl.reset ground_values;
+    TermHashtbl.replace ground_values t gv
+
+  (** Raised when a term or expression has no ground value, or when two ground values cannot be compared. *)
+  exception Not_ground
+
+  let rec ground_value_eq v1 v2 =
+    match v1, v2 with
+      GInt n1, GInt n2 -> eq_big_int n1 n2
+    | GBool b1, GBool b2 -> b1 = b2
+    | GCtor (c1, vs1), GCtor (c2, vs2) -> c1 = c2 && List.length vs1 = List.length vs2 && List.for_all2 ground_value_eq vs1 vs2
+    | _ -> raise Not_ground (* Values of different kinds; do not guess. *)
+
+  let rec buffer_add_ground_value buf v =
+    match v with
+      GInt n -> Buffer.add_string buf (string_of_big_int n)
+    | GBool b -> Buffer.add_string buf (if b then "true" else "false")
+    | GCtor (c, vs) ->
+      Buffer.add_string buf c;
+      if vs <> [] then begin
+        Buffer.add_char buf '(';
+        List.iteri (fun i v -> if i > 0 then Buffer.add_char buf ','; buffer_add_ground_value buf v) vs;
+        Buffer.add_char buf ')'
+      end
+
+  let ground_list gvs = List.fold_right (fun gv l -> GCtor ("cons", [gv; l])) gvs (GCtor ("nil", []))
+
   let nil_symb = lazy_purefuncsymb "nil"
   
   let mk_nil () = mk_app !!nil_symb []
@@ -5768,7 +6002,52 @@ module VerifyProgram1(VerifyProgramArgs: VERIFY_PROGRAM_ARGS) = struct
       else
         mk_cons charType (ctxt#mk_intlit (as_signed_char (Char.code s.[k]))) (iter (k + 1))
     in
-    iter 0
+    let t = iter 0 in
+    set_ground_value t (ground_list (List.init size (fun k -> GInt (big_int_of_int (if k < n then as_signed_char (Char.code s.[k]) else 0)))));
+    t
+  
+  (* Region: built-in list axioms *)
+  
+  (* With -list_theory, the list.gh lemmas append_assoc, nth_append, nth_append_r and reverse_append are assumed as
+     axioms, triggered by the left-hand sides of their conclusions, so that proofs about lists need not call them. *)
+  let () =
+    let list_gh_symb g =
+      match try_assoc g purefuncmap with
+        Some (Lexed ((path, _, _), _), _, _, _, symb) when Filename.basename path = "list.gh" -> Some symb
+      | _ -> None
+    in
+    if list_theory then
+    match list_gh_symb "append", list_gh_symb "length", list_gh_symb "nth", list_gh_symb "reverse" with
+      Some append, Some length, Some nth, Some reverse ->
+      let axiom name tps f =
+        ctxt#begin_formal;
+        let (trigger, body) = f (imap (fun k tp -> ctxt#mk_bound k tp) tps) in
+        ctxt#end_formal;
+        ctxt#assume_forall name [trigger] tps body
+      in
+      let tint = ctxt#type_int in
+      let tlist = ctxt#type_inductive in
+      axiom "append_assoc" [tlist; tlist; tlist] begin fun [xs; ys; zs] ->
+        let lhs = mk_app append [mk_app append [xs; ys]; zs] in
+        (lhs, ctxt#mk_eq lhs (mk_app append [xs; mk_app append [ys; zs]]))
+      end;
+      axiom "nth_append" [tint; tlist; tlist] begin fun [i; xs; ys] ->
+        let lhs = mk_app nth [i; mk_app append [xs; ys]] in
+        let cond = ctxt#mk_and (ctxt#mk_le (ctxt#mk_intlit 0) i) (ctxt#mk_lt i (mk_app length [xs])) in
+        (lhs, ctxt#mk_implies cond (ctxt#mk_eq lhs (mk_app nth [i; xs])))
+      end;
+      (* nth_append_r, with i replaced by i - length(xs) so that the trigger contains no arithmetic *)
+      axiom "nth_append_r" [tint; tlist; tlist] begin fun [i; xs; ys] ->
+        let lhs = mk_app nth [i; mk_app append [xs; ys]] in
+        let j = ctxt#mk_sub i (mk_app length [xs]) in
+        let cond = ctxt#mk_and (ctxt#mk_le (mk_app length [xs]) i) (ctxt#mk_lt j (mk_app length [ys])) in
+        (lhs, ctxt#mk_implies cond (ctxt#mk_eq lhs (mk_app nth [j; ys])))
+      end;
+      axiom "reverse_append" [tlist; tlist] begin fun [xs; ys] ->
+        let lhs = mk_app reverse [mk_app append [xs; ys]] in
+        (lhs, ctxt#mk_eq lhs (mk_app append [mk_app reverse [ys]; mk_app reverse [xs]]))
+      end
+    | _ -> ()
   
   
   (* data type to represent ancestries *)
@@ -6101,16 +6380,27 @@ let check_if_list_is_defined () =
   
   (* TODO: To improve performance, push only when branching, i.e. not at every assume. *)
   
+  (** Incremented by each [assume]; results cached for a path condition are valid while it is unchanged. *)
+  let assume_generation = ref 0
+  
   let assume t cont =
     !stats#proverAssume;
+    incr assume_generation;
+    let saved_contextStack = !contextStack in (* [cont] may leave contexts pushed by in_context on top. *)
     push_context (Assuming t);
     ctxt#push;
+    let saved_term_intervals = !term_intervals_undo_stack in
     let result =
-      match ctxt#assume t with
-        Unknown -> cont()
-      | Unsat -> major_success ()
+      try
+        match ctxt#assume t with
+          Unknown -> refine_term_intervals t; cont()
+        | Unsat -> major_success ()
+      with BudgetExceeded _ | FunctionBudgetExceeded _ as e ->
+        (* with_function_budget restores the rest of the state. *)
+        ctxt#pop; raise e
     in
-    pop_context();
+    undo_term_intervals saved_term_intervals;
+    contextStack := saved_contextStack;
     ctxt#pop;
     result
   
@@ -6124,7 +6414,7 @@ let check_if_list_is_defined () =
   
   let query_term t = 
     !stats#proverOtherQuery;
-    (ctxt#query t)
+    ctxt#query t
   
   let assert_term t h env l msg url = 
     !stats#proverOtherQuery;
@@ -6145,10 +6435,24 @@ let check_if_list_is_defined () =
   
   let check_overflow l min t max assert_term =
     if not disable_overflow_check then begin
+      !stats#overflowCheckByProver;
       assert_term l (ctxt#mk_le min t) "Potential arithmetic underflow." (Some "potentialarithmeticunderflow");
       assert_term l (ctxt#mk_le t max) "Potential arithmetic overflow." (Some "potentialarithmeticoverflow")
     end
 
+  (** Checks that [t] is a value of type [tp], without querying the prover if the interval of [t] shows it. *)
+  let check_overflow_of_type l tp t assert_term =
+    if not disable_overflow_check then begin
+      match interval_of_term t, interval_of_type false tp with
+        Some iv, Some type_iv when interval_within iv type_iv -> !stats#overflowCheckDischargedLocally
+      | _ ->
+        let min, max = limits_of_type tp in
+        check_overflow l min t max assert_term;
+        match interval_of_type true tp with
+          Some type_iv -> set_term_interval t (match interval_of_term t with Some iv when interval_within iv type_iv -> iv | _ -> type_iv)
+        | None -> ()
+    end
+
   let woperation_type_result_type op t =
     match op with
       Le|Ge|Lt|Gt|Eq|Neq -> Bool 
@@ -6174,8 +6478,12 @@ let check_if_list_is_defined () =
     let check_overflow0 v =
       begin match ass_term with
         Some assert_term ->
-        let min, max = limits_of_type (woperation_type_result_type op t) in
-        check_overflow l min v max assert_term
+        begin match op, t, interval_of_term v1, interval_of_term v2 with
+          (Add|Sub|Mul), Int (_, _), Some iv1, Some iv2 ->
+          begin match interval_of_op op iv1 iv2 with Some iv -> set_term_interval v iv | None -> () end
+        | _ -> ()
+        end;
+        check_overflow_of_type l (woperation_type_result_type op t) v assert_term
       | _ -> ()
       end;
       v
@@ -6186,8 +6494,15 @@ let check_if_list_is_defined () =
       else
         check_overflow0 v
     in
+    let record_comparison strict v1 v2 v =
+      if ass_term <> None then record_condition_operands v (Comparison (strict, v1, v2));
+      v
+    in
     begin match op with
-      And -> ctxt#mk_and v1 v2
+      And ->
+      let v = ctxt#mk_and v1 v2 in
+      if ass_term <> None then record_condition_operands v (Conjunction (v1, v2));
+      v
     | Or -> ctxt#mk_or v1 v2
     | Eq ->
       if t = Bool then
@@ -6227,10 +6542,10 @@ let check_if_list_is_defined () =
       begin match t with
         Int (_, _) | PtrType _ ->
         begin match op with
-          Le -> ctxt#mk_le v1 v2
-        | Lt -> ctxt#mk_lt v1 v2
-        | Ge -> ctxt#mk_le v2 v1
-        | Gt -> ctxt#mk_lt v2 v1
+          Le -> record_comparison false v1 v2 (ctxt#mk_le v1 v2)
+        | Lt -> record_comparison true v1 v2 (ctxt#mk_lt v1 v2)
+        | Ge -> record_comparison false v2 v1 (ctxt#mk_le v2 v1)
+        | Gt -> record_comparison true v2 v1 (ctxt#mk_lt v2 v1)
         end
       | RealType ->
         begin match op with
@@ -6281,6 +6596,118 @@ let check_if_list_is_defined () =
     | _ -> static_error l "This operator is not supported in this position." None
     end
 
+  (* Region: ground evaluation of fixpoint functions *)
+
+  let ground_ctors =
+    let ctors = Hashtbl.create 100 in
+    inductivemap |> List.iter (fun (_, (_, _, ctormap, _, _, _, _, _)) -> ctormap |> List.iter (fun (_, (full_cn, _)) -> Hashtbl.replace ctors full_cn ()));
+    ctors
+
+  let ctor_full_name i cn =
+    let (_, _, ctormap, _, _, _, _, _) = List.assoc i inductivemap in
+    fst (List.assoc cn ctormap)
+
+  let ground_fixpoints =
+    let fixpoints = Hashtbl.create 100 in
+    fixpointmap1 |> List.iter (fun (g, (_, rt, pmap, index, body, _, _, _)) -> Hashtbl.replace fixpoints g (rt, pmap, index, body));
+    fixpoints
+
+  (* Bounds the number of evaluation steps of a single ground fixpoint application. *)
+  let ground_eval_fuel = ref 0
+
+  let rec ground_eval env e =
+    decr ground_eval_fuel;
+    if !ground_eval_fuel < 0 then raise Not_ground;
+    let int_of e = match ground_eval env e with GInt n -> n | _ -> raise Not_ground in
+    let bool_of e = match ground_eval env e with GBool b -> b | _ -> raise Not_ground in
+    match e with
+      True _ -> GBool true
+    | False _ -> GBool false
+    | WIntLit (_, n) -> GInt n
+    | WVar (_, x, LocalVar) -> begin match try_assoc x env with Some v -> v | None -> raise Not_ground end
+    | WVar (_, x, PureCtor) -> if Hashtbl.mem ground_ctors x then GCtor (x, []) else raise Not_ground (* A nullary fixpoint or uninterpreted function *)
+    | ProverTypeConversion (_, _, e) | Upcast (e, _, _) | TypedExpr (e, _) | WidenedParameterArgument e -> ground_eval env e
+    | WOperation (_, Not, [e], _) -> GBool (not (bool_of e))
+    | WOperation (_, And, [e1; e2], _) -> GBool (bool_of e1 && bool_of e2)
+    | WOperation (_, Or, [e1; e2], _) -> GBool (bool_of e1 || bool_of e2)
+    | WOperation (_, Eq, [e1; e2], _) -> GBool (ground_value_eq (ground_eval env e1) (ground_eval env e2))
+    | WOperation (_, Neq, [e1; e2], _) -> GBool (not (ground_value_eq (ground_eval env e1) (ground_eval env e2)))
+    | WOperation (_, (Add|Sub|Mul|Le|Lt|Ge|Gt as op), [e1; e2], Int (_, _)) ->
+      let n1 = int_of e1 in
+      let n2 = int_of e2 in
+      begin match op with
+        Add -> GInt (add_big_int n1 n2)
+      | Sub -> GInt (sub_big_int n1 n2)
+      | Mul -> GInt (mult_big_int n1 n2)
+      | Le -> GBool (le_big_int n1 n2)
+      | Lt -> GBool (lt_big_int n1 n2)
+      | Ge -> GBool (ge_big_int n1 n2)
+      | Gt -> GBool (gt_big_int n1 n2)
+      end
+    | IfExpr (_, e1, e2, e3) -> if bool_of e1 then ground_eval env e2 else ground_eval env e3
+    | WSwitchExpr (_, e, i, _, cs, cdef_opt, _, _) ->
+      begin match ground_eval env e with
+        GCtor (c, vs) -> ground_eval_switch env i c vs cs (match cdef_opt with Some (_, e) -> Some e | None -> None)
+      | _ -> raise Not_ground
+      end
+    | WPureFunCall (_, g, _, args) ->
+      let vs = List.map (ground_eval env) args in
+      if Hashtbl.mem ground_ctors g then GCtor (g, vs) else ground_eval_fixpoint g vs
+    | _ -> raise Not_ground
+  and ground_eval_switch env i c vs cs cdef_opt =
+    match List.find_opt (fun (SwitchExprClause (_, cn, _, _)) -> ctor_full_name i cn = c) cs with
+      Some (SwitchExprClause (_, _, pats, e)) ->
+      let penv = List.filter (fun (x, _) -> x <> "_") (List.combine pats vs) in
+      ground_eval (penv @ env) e
+    | None ->
+      match cdef_opt with
+        Some e -> ground_eval env e
+      | None -> raise Not_ground
+  and ground_eval_fixpoint g vs =
+    match Hashtbl.find_opt ground_fixpoints g with
+      None -> raise Not_ground
+    | Some (_, pmap, index, body) ->
+      let env = List.combine (List.map fst pmap) vs in
+      match index, body with
+        Some _, SwitchExpr (_, Var (_, x), cs, _) ->
+        begin match List.assoc x pmap, List.assoc x env with
+          InductiveType (i, _), GCtor (c, cvs) -> ground_eval_switch env i c cvs cs None
+        | _ -> raise Not_ground
+        end
+      | None, w -> ground_eval env w
+      | _ -> raise Not_ground
+
+  let ground_fixpoint_app_cache: (string, ground_value option) Hashtbl.t = Hashtbl.create 1000
+
+  (** If [g] is a fixpoint function with an int or bool result and the terms [vs] have ground values, returns the
+      term for the value of the application of [g] to [vs]. *)
+  let eval_ground_fixpoint_app g vs =
+    match Hashtbl.find_opt ground_fixpoints g with
+      Some (rt, _, _, _) when (match unfold_inferred_type rt with Int (_, _) | Bool -> true | _ -> false) ->
+      let gvs = flatmap (fun v -> match ground_value_of_term v with Some gv -> [gv] | None -> []) vs in
+      if List.length gvs <> List.length vs then None else
+      let key =
+        let buf = Buffer.create 100 in
+        buffer_add_ground_value buf (GCtor (g, gvs));
+        Buffer.contents buf
+      in
+      let result =
+        match Hashtbl.find_opt ground_fixpoint_app_cache key with
+          Some result -> result
+        | None ->
+          ground_eval_fuel := 100000;
+          let result = try Some (ground_eval_fixpoint g gvs) with Not_ground -> None in
+          if Hashtbl.length ground_fixpoint_app_cache > 10000 then Hashtbl.reset ground_fixpoint_app_cache;
+          Hashtbl.replace ground_fixpoint_app_cache key result;
+          result
+      in
+      begin match result with
+        Some (GInt n as gv) -> let t = term_of_big_int n in set_ground_value t gv; Some t
+      | Some (GBool b as gv) -> let t = if b then ctxt#mk_true else ctxt#mk_false in set_ground_value t gv; Some t
+      | _ -> None
+      end
+    | _ -> None
+
   let rec eval_core_cps0 eval_core ev state ass_term read_field env e cont =
      let evs state es cont =
       let rec iter state vs es =
@@ -6290,24 +6717,20 @@ let check_if_list_is_defined () =
       in
       iter state [] es
     in
-    let check_overflow l min t max =
-      begin
-      match ass_term with
-        Some assert_term -> check_overflow l min t max assert_term
-      | _ -> ()
-      end;
-      t
-    in
     match e with
-      True l -> cont state ctxt#mk_true
-    | False l -> cont state ctxt#mk_false
+      True l -> set_ground_value ctxt#mk_true (GBool true); cont state ctxt#mk_true
+    | False l -> set_ground_value ctxt#mk_false (GBool false); cont state ctxt#mk_false
     | Null l -> cont state (ctxt#mk_intlit 0)
     | WVar (l, x, scope) ->
       cont state
       begin
         match scope with
           LocalVar -> (try List.assoc x env with Not_found -> assert_false [] env l (Printf.sprintf "Unbound variable '%s'" x) None)
-        | PureCtor -> let Some (lg, tparams, t, [], s) = try_assoc x purefuncmap in mk_app s []
+        | PureCtor ->
+          let Some (lg, tparams, t, [], s) = try_assoc x purefuncmap in
+          let v = mk_app s [] in
+          if Hashtbl.mem ground_ctors x then set_ground_value v (GCtor (x, []));
+          v
         | FuncName -> List.assoc x all_funcnameterms
         | PredFamName -> let Some (_, _, _, _, symb, _, _) = try_assoc x predfammap in symb
         | EnumElemName n -> ctxt#mk_intlit_of_string (string_of_big_int n)
@@ -6342,8 +6765,11 @@ let check_if_list_is_defined () =
         match (e, t) with
           (e, (Int (_, _) | PtrType _ as tp)) ->
           ev state e $. fun state t ->
-          let min, max = limits_of_type tp in
-          cont state (check_overflow l min t max)
+          begin match ass_term with
+            Some assert_term -> check_overflow_of_type l tp t assert_term
+          | None -> ()
+          end;
+          cont state t
         | (_, (ObjType _|ArrayType _)) when ass_term = None -> static_error l "Class casts are not allowed in annotations." None
         | _ -> ev state e cont (* No other cast allowed by the type checker changes the value *)
       end
@@ -6366,6 +6792,8 @@ let check_if_list_is_defined () =
           exception Failure _ -> ctxt#mk_intlit_of_string (string_of_big_int n)
         | n -> ctxt#mk_intlit n
       in
+      if ass_term <> None && interval_of_term v = None then set_term_interval v (n, n);
+      set_ground_value v (GInt n);
       cont state v
     | ClassLit (l,s) -> cont state (List.assoc s classterms)
     | StringLit (l, s) ->
@@ -6391,7 +6819,15 @@ let check_if_list_is_defined () =
           None -> static_error l ("No such pure function: "^g) None
         | Some (lg, tparams, t, pts, s) ->
           evs state args $. fun state vs ->
-          cont state (mk_app s vs)
+          match eval_ground_fixpoint_app g vs with
+            Some v -> cont state v
+          | None ->
+            let v = mk_app s vs in
+            if Hashtbl.mem ground_ctors g then begin
+              let gvs = flatmap (fun v -> match ground_value_of_term v with Some gv -> [gv] | None -> []) vs in
+              if List.length gvs = List.length vs then set_ground_value v (GCtor (g, gvs))
+            end;
+            cont state v
         end
       end
     | WPureFunValueCall (l, e, es) ->
@@ -6449,16 +6885,27 @@ let check_if_list_is_defined () =
         | _ -> None
       in
       evs state [e1; e2] $. fun state [v1; v2] ->
-      let symb, uintN_symb, intN_symb = match op with
-          BitAnd -> bitwise_and_symbol, !!bitand_uintN_symb, !!bitand_intN_symb
-        | BitXor -> bitwise_xor_symbol, !!bitxor_uintN_symb, !!bitxor_intN_symb
-        | BitOr -> bitwise_or_symbol, !!bitor_uintN_symb, !!bitor_intN_symb
+      let symb, uintN_symb, intN_symb, bv_op = match op with
+          BitAnd -> bitwise_and_symbol, !!bitand_uintN_symb, !!bitand_intN_symb, BvAnd
+        | BitXor -> bitwise_xor_symbol, !!bitxor_uintN_symb, !!bitxor_intN_symb, BvXor
+        | BitOr -> bitwise_or_symbol, !!bitor_uintN_symb, !!bitor_intN_symb, BvOr
       in
       let v = ctxt#mk_app symb [v1; v2] in
+      (* In bit-vector mode, the prover's bit-vector theory, if any, also defines the result. *)
+      let assume_eq_bitvector_op signed width =
+        if bitvectors then
+          match ctxt#mk_bitwise bv_op signed width v1 v2 with
+            Some bv -> ctxt#assert_term (ctxt#mk_eq v bv)
+          | None -> ()
+      in
       let assume_eq_bounded_op t =
         match t with
-          Int (Unsigned, LitRank k) -> ctxt#assert_term (ctxt#mk_eq v (mk_app uintN_symb [v1; v2; ctxt#mk_intlit ((1 lsl k) * 8)]))
-        | Int (Signed, LitRank k) -> ctxt#assert_term (ctxt#mk_eq v (mk_app intN_symb [v1; v2; ctxt#mk_intlit ((1 lsl k) * 8 - 1)]))
+          Int (Unsigned, LitRank k) ->
+          ctxt#assert_term (ctxt#mk_eq v (mk_app uintN_symb [v1; v2; ctxt#mk_intlit ((1 lsl k) * 8)]));
+          assume_eq_bitvector_op false ((1 lsl k) * 8)
+        | Int (Signed, LitRank k) ->
+          ctxt#assert_term (ctxt#mk_eq v (mk_app intN_symb [v1; v2; ctxt#mk_intlit ((1 lsl k) * 8 - 1)]));
+          assume_eq_bitvector_op true ((1 lsl k) * 8)
         | _ -> ()
       in
       let t =
@@ -6639,7 +7086,11 @@ let check_if_list_is_defined () =
       in
       ctxt#set_fpclauses symbol 0 fpclauses;
       cont state (ctxt#mk_app symbol (t::List.map (fun (x, t) -> t) env))
-    | ProverTypeConversion (tfrom, tto, e) -> ev state e $. fun state v -> cont state (convert_provertype v tfrom tto)
+    | ProverTypeConversion (tfrom, tto, e) ->
+      ev state e $. fun state v ->
+      let v' = convert_provertype v tfrom tto in
+      begin match ground_value_of_term v with Some gv -> set_ground_value v' gv | None -> () end;
+      cont state v'
     | SizeofExpr (l, TypeExpr (ManifestTypeExpr (_, t))) ->
       cont state (sizeof l t)
     | InstanceOfExpr(l, e, ManifestTypeExpr (l2, tp)) ->
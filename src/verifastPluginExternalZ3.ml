@@ -10,7 +10,7 @@ let _ =
       let z3_ctxt =
         Sp.external_smtlib_ctxt
           "z3 -in -smt2 smt.auto_config=false smt.mbqi=false auto_config=false model=false type_check=true well_sorted_check=true"
-          ["z3"; "I"; "Q"; "NDT"; "LIA"; "LRA"]
+          ["z3"; "I"; "Q"; "NDT"; "LIA"; "LRA"; "BV"]
       in
       client#run z3_ctxt
     )
@@ -0,0 +1,20 @@
+module R = Redux
+module U = Ccprover
+module C = Combineprovers
+module P = Proverapi
+
+let _ =
+  Verifast.register_prover "UF+Redux"
+    "(experimental) an array-based congruence closure engine for equalities and uninterpreted functions, with Redux as a fallback for what it cannot prove."
+    (
+      fun client ->
+      let uf_ctxt =
+        (new U.context ():
+           U.context :> (unit, U.symbol, int) P.context)
+      in
+      let redux_ctxt =
+        (new R.context ():
+           R.context :> (unit, R.symbol, (R.symbol, R.termnode) R.term) P.context)
+      in
+      client#run (C.combine uf_ctxt redux_ctxt C.Sequence)
+    )
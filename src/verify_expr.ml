@@ -151,7 +151,7 @@ module VerifyExpr(VerifyProgramArgs: VERIFY_PROGRAM_ARGS) = struct
       let (inputArgs, outputArgs) = take_drop n real_args in
       List.for_all2 definitely_equal indices fsymbs &&
       let env = List.map2 (fun (x, tp0) t -> let tp = instantiate_type tpenv tp0 in (x, prover_convert_term t tp tp0)) inputParams inputArgs in
-      List.exists (fun conds -> List.for_all (fun cond -> ctxt#query (eval None env cond)) conds) conds
+      List.exists (fun conds -> ctxt#query_all (List.map (fun cond () -> eval None env cond) conds)) conds
     )
     empty_preds
   
@@ -2207,8 +2207,7 @@ module VerifyExpr(VerifyProgramArgs: VERIFY_PROGRAM_ARGS) = struct
             end with
             | Some (Chunk (_, _, coef, [arr'; size'; signed'; count'; vs], _), h) ->
               if not (definitely_equal coef real_unit) then assert_false h0 env l "Assignment requires full permission." None;
-              let (_, _, _, _, update_symb) = List.assoc "update" purefuncmap in
-              let updated = mk_app update_symb [i; apply_conversion (provertype_of_type elem_tp) ProverInductive value; vs] in
+              let updated = mk_array_update elem_tp i value vs in
               assume (ctxt#mk_eq (mk_length updated) count') $. fun () ->
               cont (Chunk (integers__symb, [], real_unit, [arr'; size'; signed'; count'; updated], None)::h) env
             | None ->
@@ -2232,8 +2231,7 @@ module VerifyExpr(VerifyProgramArgs: VERIFY_PROGRAM_ARGS) = struct
         end with
         | Some (Chunk (_, _, coef, [a; n; vs], _), h) ->
           if not (definitely_equal coef real_unit) then assert_false h0 env l "Assignment requires full permission." None;
-          let (_, _, _, _, update_symb) = List.assoc "update" purefuncmap in
-          let updated = mk_app update_symb [i; apply_conversion (provertype_of_type elem_tp) ProverInductive value; vs] in
+          let updated = mk_array_update elem_tp i value vs in
           assume (ctxt#mk_eq (mk_length updated) n) $. fun () ->
           cont (Chunk (arrayPredSymb1, [], real_unit, [a; n; updated], None) :: h) env
         | None ->
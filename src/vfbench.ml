@@ -0,0 +1,226 @@
+(* vfbench: runs a curated list of VeriFast benchmarks under several provers, records wall time,
+   symbolic execution counters and peak memory use, and compares the results against a baseline. *)
+
+open Json
+
+let (|>) x f = f x
+
+let verifast_path = ref (Filename.concat (Filename.dirname Sys.executable_name) (if Sys.win32 then "verifast.exe" else "verifast"))
+let provers = ref ["redux"; "z3v4.5"; "ext_z3"]
+let runs = ref 3
+let output_filename = ref None
+let baseline_filename = ref None
+let time_threshold = ref 0.10     (* Relative wall time increase reported as a regression. *)
+let time_slack = ref 0.05         (* Absolute wall time increase (in seconds) below which no regression is reported, to absorb noise on short benchmarks. *)
+let counter_threshold = ref 0.0   (* Relative increase of a deterministic counter (execution steps, prover queries, ...) reported as a regression. *)
+let rss_threshold = ref 0.20      (* Relative peak RSS increase reported as a regression. *)
+let benchmarks_filename = ref None
+
+(* Counters that measure work done; an increase is a regression. The other counters are reported but not compared. *)
+let cost_counters = ["execSteps"; "branches"; "proverAssumes"; "equalityQueries"; "otherProverQueries"]
+
+let split_words s =
+  String.split_on_char ' ' (String.map (fun c -> if c = '\t' then ' ' else c) s) |> List.filter (fun w -> w <> "")
+
+(* A benchmark file line has the form "<directory relative to the current directory> <verifast arguments>".
+   Empty lines and lines starting with '#' are ignored. *)
+let read_benchmarks filename =
+  let chan = open_in filename in
+  let rec iter benchmarks =
+    match try Some (input_line chan) with End_of_file -> None with
+      None -> close_in chan; List.rev benchmarks
+    | Some line ->
+      match split_words line with
+        [] -> iter benchmarks
+      | w::_ when w.[0] = '#' -> iter benchmarks
+      | dir::args -> iter ((dir, args)::benchmarks)
+  in
+  iter []
+
+let benchmark_name (dir, args) = String.concat " " (dir::args)
+
+let median xs =
+  let xs = Array.of_list (List.sort compare xs) in
+  let n = Array.length xs in
+  if n mod 2 = 1 then xs.(n / 2) else (xs.(n / 2 - 1) +. xs.(n / 2)) /. 2.0
+
+let float_of_json = function
+  I i -> float_of_int i
+| F f -> f
+| _ -> failwith "Number expected"
+
+type run_result =
+  RunOk of float * (string * float) list (* wall time, counters *)
+| RunFailed of string
+
+let run_verifast (dir, args) prover =
+  let cmd =
+    Printf.sprintf "cd %s && %s -json -stats -prover %s %s"
+      (Filename.quote dir) (Filename.quote !verifast_path) (Filename.quote prover) (String.concat " " (List.map Filename.quote args))
+  in
+  let t0 = Unix.gettimeofday () in
+  let chan = Unix.open_process_in cmd in
+  let rec read_result result =
+    match try Some (input_line chan) with End_of_file -> None with
+      None -> result
+    | Some line ->
+      let prefix = "[\"VeriFast-Json\"" in
+      if String.length line >= String.length prefix && String.sub line 0 (String.length prefix) = prefix then
+        read_result (Some line)
+      else
+        read_result result
+  in
+  let result = read_result None in
+  let status = Unix.close_process_in chan in
+  let wallTime = Unix.gettimeofday () -. t0 in
+  match result with
+    None -> RunFailed (Printf.sprintf "no JSON result (exit status %s)" (match status with Unix.WEXITED n -> string_of_int n | _ -> "abnormal"))
+  | Some line ->
+    match parse_json line with
+      A [S "VeriFast-Json"; I _; I _; O props] ->
+      begin match List.assoc_opt "result" props with
+        Some (A (S "success"::_)) ->
+        let counters =
+          match List.assoc_opt "stats" props with
+            Some (O kvs) -> List.map (fun (k, v) -> (k, float_of_json v)) kvs
+          | _ -> []
+        in
+        RunOk (wallTime, counters)
+      | Some (A (S kind::_)) -> RunFailed kind
+      | _ -> RunFailed "malformed result"
+      end
+    | _ -> RunFailed "malformed result"
+
+(* Runs the benchmark !runs times and summarizes it as a JSON object holding the median of each measurement. *)
+let measure benchmark prover =
+  let name = benchmark_name benchmark in
+  let rec iter k samples =
+    if k = 0 then Ok (List.rev samples) else
+    match run_verifast benchmark prover with
+      RunOk (t, counters) -> iter (k - 1) ((t, counters)::samples)
+    | RunFailed msg -> Error msg
+  in
+  let props = ["benchmark", S name; "prover", S prover] in
+  match iter !runs [] with
+    Error msg ->
+    Printf.printf "%-60s %-8s FAILED: %s\n%!" name prover msg;
+    O (props @ ["status", S "failed"; "message", S msg])
+  | Ok samples ->
+    let wallTimes = List.map fst samples in
+    let counterNames = match samples with (_, counters)::_ -> List.map fst counters | [] -> [] in
+    let counters =
+      counterNames |> List.map begin fun k ->
+        (k, median (samples |> List.map (fun (_, counters) -> try List.assoc k counters with Not_found -> 0.0)))
+      end
+    in
+    let wallTime = median wallTimes in
+    let counter k = try List.assoc k counters with Not_found -> 0.0 in
+    Printf.printf "%-60s %-8s %8.3fs  steps: %8.0f  branches: %6.0f  assumes: %7.0f  queries: %7.0f  peak RSS: %7.0f kB\n%!"
+      name prover wallTime (counter "execSteps") (counter "branches") (counter "proverAssumes")
+      (counter "equalityQueries" +. counter "otherProverQueries") (counter "peakRssKb");
+    O (props @ [
+      "status", S "ok";
+      "wallTime", F wallTime;
+      "wallTimes", A (List.map (fun t -> F t) wallTimes);
+      "counters", O (List.map (fun (k, v) -> (k, F v)) counters)
+    ])
+
+let get_string props k = match List.assoc_opt k props with Some (S s) -> s | _ -> ""
+let get_float props k = match List.assoc_opt k props with Some (I _ | F _ as v) -> Some (float_of_json v) | _ -> None
+let get_counters props = match List.assoc_opt "counters" props with Some (O kvs) -> kvs | _ -> []
+
+let results_of_json json =
+  match json with
+    O props ->
+    begin match List.assoc_opt "results" props with
+      Some (A results) -> results |> List.map (function O props -> props | _ -> failwith "Malformed results file")
+    | _ -> failwith "Malformed results file"
+    end
+  | _ -> failwith "Malformed results file"
+
+(* Returns the list of regressions of the current results relative to the baseline results. *)
+let compare_with_baseline baseline results =
+  let regressions = ref [] in
+  let report key fmt = Printf.ksprintf (fun msg -> regressions := (key ^ ": " ^ msg)::!regressions) fmt in
+  results |> List.iter begin fun props ->
+    let name = get_string props "benchmark" in
+    let prover = get_string props "prover" in
+    let key = Printf.sprintf "%s [%s]" name prover in
+    match List.find_opt (fun b -> get_string b "benchmark" = name && get_string b "prover" = prover) baseline with
+      None -> ()
+    | Some base ->
+      match get_string base "status", get_string props "status" with
+        "ok", "ok" ->
+        begin match get_float base "wallTime", get_float props "wallTime" with
+          Some t0, Some t1 when t1 > t0 *. (1.0 +. !time_threshold) && t1 -. t0 > !time_slack ->
+          report key "wall time %.3fs -> %.3fs (%+.1f%%)" t0 t1 ((t1 -. t0) /. t0 *. 100.0)
+        | _ -> ()
+        end;
+        let baseCounters = get_counters base in
+        let counters = get_counters props in
+        let check k threshold =
+          match List.assoc_opt k baseCounters, List.assoc_opt k counters with
+            Some v0, Some v1 ->
+            let v0 = float_of_json v0 and v1 = float_of_json v1 in
+            if v1 > v0 *. (1.0 +. threshold) then
+              report key "%s %.0f -> %.0f (%+.1f%%)" k v0 v1 (if v0 = 0.0 then infinity else (v1 -. v0) /. v0 *. 100.0)
+          | _ -> ()
+        in
+        List.iter (fun k -> check k !counter_threshold) cost_counters;
+        check "peakRssKb" !rss_threshold
+      | "ok", _ -> report key "verification no longer succeeds (%s)" (get_string props "message")
+      | _ -> ()
+  end;
+  List.rev !regressions
+
+let () =
+  let set_provers s = provers := String.split_on_char ',' s |> List.filter (fun p -> p <> "") in
+  let set_output s = output_filename := Some s in
+  let set_baseline s = baseline_filename := Some s in
+  let cla = [
+    "-verifast", Arg.Set_string verifast_path, "PATH  VeriFast executable to benchmark (default: the verifast next to vfbench)";
+    "-provers", Arg.String set_provers, "P1,P2,...  Provers to run each benchmark under (default: redux,z3v4.5,ext_z3)";
+    "-runs", Arg.Set_int runs, "N  Number of runs per benchmark and prover; the median is reported (default: 3)";
+    "-o", Arg.String set_output, "FILE  Write the results as JSON to FILE";
+    "-baseline", Arg.String set_baseline, "FILE  Compare against the results in FILE and exit with code 1 on regressions";
+    "-time_threshold", Arg.Set_float time_threshold, "R  Relative wall time increase reported as a regression (default: 0.10)";
+    "-time_slack", Arg.Set_float time_slack, "S  Ignore wall time increases of less than S seconds (default: 0.05)";
+    "-counter_threshold", Arg.Set_float counter_threshold, "R  Relative counter increase reported as a regression (default: 0.0)";
+    "-rss_threshold", Arg.Set_float rss_threshold, "R  Relative peak RSS increase reported as a regression (default: 0.20)";
+  ] in
+  let usage = "Usage: vfbench [options] benchmarks.txt\n\nEach line of benchmarks.txt is a directory followed by the VeriFast arguments to run there.\n" in
+  Arg.parse cla (fun s -> benchmarks_filename := Some s) usage;
+  let benchmarks_filename = match !benchmarks_filename with Some f -> f | None -> Arg.usage cla usage; exit 2 in
+  if Filename.is_relative !verifast_path then verifast_path := Filename.concat (Sys.getcwd ()) !verifast_path;
+  let benchmarks = read_benchmarks benchmarks_filename in
+  let results =
+    benchmarks |> List.map (fun benchmark -> !provers |> List.map (fun prover -> measure benchmark prover)) |> List.concat
+  in
+  let resultsJson = O ["runs", I !runs; "provers", A (List.map (fun p -> S p) !provers); "results", A results] in
+  begin match !output_filename with
+    None -> ()
+  | Some filename ->
+    let buf = Buffer.create 4096 in
+    buffer_add_json_pp buf 2 resultsJson;
+    Buffer.add_char buf '\n';
+    let chan = open_out_bin filename in
+    Buffer.output_buffer chan buf;
+    close_out chan;
+    Printf.printf "Results written to %s\n" filename
+  end;
+  let failures = results_of_json resultsJson |> List.filter (fun props -> get_string props "status" <> "ok") in
+  match !baseline_filename with
+    None -> if failures <> [] then exit 1
+  | Some filename ->
+    let baseline =
+      let chan = open_in_bin filename in
+      let text = really_input_string chan (in_channel_length chan) in
+      close_in chan;
+      results_of_json (parse_json text)
+    in
+    match compare_with_baseline baseline (results_of_json resultsJson) with
+      [] -> Printf.printf "No regressions relative to %s\n" filename; if failures <> [] then exit 1
+    | regressions ->
+      Printf.printf "%d regression(s) relative to %s:\n" (List.length regressions) filename;
+      List.iter (fun msg -> Printf.printf "  %s\n" msg) regressions;
+      exit 1
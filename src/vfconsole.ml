@@ -34,6 +34,42 @@ let json_of_ctxt ctxt =
   | PushSubcontext -> A [S "PushSubcontext"]
   | PopSubcontext -> A [S "PopSubcontext"]
   | Branching b -> A [S "Branching"; S (match b with LeftBranch -> "LeftBranch" | RightBranch -> "RightBranch")]
+let json_of_function_budget_exceeded (l, g, ctxts, msg) = A [json_of_loc l; S g; S msg; A (List.map json_of_ctxt ctxts)]
+
+let json_of_qi_profile () =
+  let open Proverapi in
+  let sorted_counts tbl = Hashtbl.fold (fun k n acc -> (k, !n)::acc) tbl [] |> List.sort (fun (_, n1) (_, n2) -> compare n2 n1) in
+  let axioms = Hashtbl.fold (fun axiom p acc -> (axiom, p)::acc) qi_axioms [] in
+  let axioms = List.sort (fun (_, p1) (_, p2) -> compare p2.qi_instances p1.qi_instances) axioms in
+  O [
+    "axioms", A (axioms |> List.map begin fun (axiom, p) ->
+      O [
+        "axiom", S axiom;
+        "instances", I p.qi_instances;
+        "time", F p.qi_time;
+        "maxGeneration", I p.qi_max_generation;
+        "sources", A (sorted_counts p.qi_sources |> List.map (fun (source, n) -> A [S source; I n]))
+      ]
+    end);
+    "cascades", A (sorted_counts qi_stacks |> List.map (fun (stack, n) -> A [A (List.map (fun frame -> S frame) stack); I n]))
+  ]
+
+let json_of_profile () =
+  let open Stats in
+  let json_of_counters c =
+    [
+      "selfTime", F c.profile_self_time;
+      "proverTime", F c.profile_prover_time;
+      "proverQueries", I c.profile_prover_queries;
+      "branches", I c.profile_branches;
+      "chunkMatches", I c.profile_chunk_matches
+    ]
+  in
+  let lines = profile_line_counters () in
+  O [
+    "totalTime", F (List.fold_left (fun t (_, c) -> t +. c.profile_self_time) profile_root.profile_frame_counters.profile_self_time lines);
+    "lines", A (lines |> List.map (fun ((path, line), c) -> O (["file", S path; "line", I line] @ json_of_counters c)))
+  ]
 
 module HashedLoc = struct
   type t = loc0
@@ -49,11 +85,18 @@ module HashedLine = struct
 end
 module LineHashtbl = Hashtbl.Make(HashedLine)
 
+(** Raised instead of exiting when a run fails in -watch mode. *)
+exception WatchedRunFailed
+
 let _ =
-  let verify ?(emitter_callback = fun _ -> ()) (print_stats : bool) (options : options) (prover : string) (path : string) (emitHighlightedSourceFiles : bool) (dumpPerLineStmtExecCounts : bool) allowDeadCode json mergeOptionsFromSourceFile =
+  (* If [watched_files] is given, the paths of all files lexed during the run are added to it, and failures raise WatchedRunFailed instead of exiting. *)
+  let verify ?(emitter_callback = fun _ -> ()) ?watched_files (print_stats : bool) (options : options) (prover : string) (path : string) (emitHighlightedSourceFiles : bool) (dumpPerLineStmtExecCounts : bool) allowDeadCode json mergeOptionsFromSourceFile =
     let exit l =
-      Java_frontend_bridge.unload();
-      exit l
+      match watched_files with
+        Some _ -> raise WatchedRunFailed
+      | None ->
+        Java_frontend_bridge.unload();
+        exit l
     in
     let reportUseSite, get_use_sites_json =
       if not json then
@@ -108,10 +151,21 @@ let _ =
         in
         reportUseSite, get_use_sites_json
     in
+    (* The functions that exceeded their time, memory or depth budget; verification continued with the next function. *)
+    let budgetsExceeded = ref [] in
+    let reportFunctionBudgetExceeded l g ctxts msg =
+      push (l, g, ctxts, msg) budgetsExceeded;
+      if not json then print_endline (string_of_loc l ^ ": " ^ g ^ ": " ^ msg)
+    in
     let exit_with_json_result resultJson =
       let majorVersion = 2 in
       let minorVersion = 0 in
-      print_json_endline (A [S "VeriFast-Json"; I majorVersion; I minorVersion; O ["result", resultJson; "useSites", get_use_sites_json ()]])
+      let statsJson = if print_stats then ["stats", O (List.map (fun (k, v) -> (k, F v)) !Stats.stats#getCounters)] else [] in
+      let budgetsJson =
+        if !budgetsExceeded = [] then [] else
+        ["functionBudgetsExceeded", A (List.rev !budgetsExceeded |> List.map json_of_function_budget_exceeded)]
+      in
+      print_json_endline (A [S "VeriFast-Json"; I majorVersion; I minorVersion; O (["result", resultJson; "useSites", get_use_sites_json ()] @ budgetsJson @ statsJson)])
     in
     let exit_with_msg l msg =
       if json then begin
@@ -190,7 +244,7 @@ let _ =
         | _ ->
           false
       in
-      let callbacks = {Verifast1.noop_callbacks with reportRange=range_callback; reportStmt; reportStmtExec; reportDirective; reportUseSite} in
+      let callbacks = {Verifast1.noop_callbacks with reportRange=range_callback; reportStmt; reportStmtExec; reportDirective; reportUseSite; reportFunctionBudgetExceeded} in
       let prover, options = 
         if mergeOptionsFromSourceFile then
           merge_options_from_source_file prover options path
@@ -200,12 +254,22 @@ let _ =
       let stats = verify_program ~emitter_callback:emitter_callback prover options path callbacks None None in
       reportDeadCode ();
       dumpPerLineStmtExecCounts ();
-      if print_stats then stats#printStats;
+      if print_stats && not json then stats#printStats;
+      if !budgetsExceeded <> [] then begin
+        let msg = Printf.sprintf "%d function(s) exceeded their time, memory or depth budget" (List.length !budgetsExceeded) in
+        if json then
+          exit_with_json_result (A [S "FunctionBudgetsExceeded"; S msg])
+        else begin
+          print_endline msg;
+          exit 1
+        end
+      end else begin
       let msg = "0 errors found (" ^ (string_of_int (stats#getStmtExec)) ^ " statements verified)" in
       if json then
         exit_with_json_result (A [S "success"; S msg])
       else
-        print_endline msg;
+        print_endline msg
+      end;
       Java_frontend_bridge.unload();
     with
       PreprocessorDivergence (l, msg) ->
@@ -329,7 +393,12 @@ let _ =
       List.iter emit_source_file !sourceFiles
     end
     else
-      verify (fun _ _ -> ())
+      let range_callback =
+        match watched_files with
+          None -> (fun _ _ -> ())
+        | Some files -> (fun _ ((path, _, _), _) -> Hashtbl.replace files path ())
+      in
+      verify range_callback
   in
   let stats = ref false in
   let json = ref false in
@@ -364,7 +433,86 @@ let _ =
   let useJavaFrontend = ref false in
   let enforceAnnotations = ref false in
   let allowUndeclaredStructTypes = ref false in
+  let listTheory = ref false in
+  let bitvectors = ref false in
+  let joinBranches = ref false in
+  let functionTimeout = ref None in
+  let functionMemoryLimit = ref None in
+  let functionMaxDepth = ref None in
   let dataModel = ref None in
+  let watch = ref false in
+  let watchedSourceFiles = ref [] in (* With -watch, the source files are verified after the command line is parsed. *)
+  let server = ref false in
+  let qiProfile = ref None in
+  let qiProfileFolded = ref None in
+  let write_qi_profile () =
+    begin match !qiProfile with
+      None -> ()
+    | Some filename ->
+      let buf = Buffer.create 4096 in
+      buffer_add_json_pp buf 2 (json_of_qi_profile ());
+      Buffer.add_char buf '\n';
+      let chan = open_out_bin filename in
+      Buffer.output_buffer chan buf;
+      close_out chan
+    end;
+    match !qiProfileFolded with
+      None -> ()
+    | Some filename -> Proverapi.qi_write_folded_stacks filename
+  in
+  let enable_qi_profiling () =
+    if not !Proverapi.qi_profiling then begin
+      Proverapi.qi_profiling := true;
+      at_exit write_qi_profile
+    end
+  in
+  let profile = ref None in
+  let profileFolded = ref None in
+  let write_profile () =
+    begin match !profile with
+      None -> ()
+    | Some filename ->
+      let buf = Buffer.create 4096 in
+      buffer_add_json_pp buf 2 (json_of_profile ());
+      Buffer.add_char buf '\n';
+      let chan = open_out_bin filename in
+      Buffer.output_buffer chan buf;
+      close_out chan
+    end;
+    match !profileFolded with
+      None -> ()
+    | Some filename -> Stats.profile_write_folded_stacks filename
+  in
+  let enable_profiling () =
+    if not !Stats.profiling then begin
+      Stats.start_profiling ();
+      at_exit write_profile
+    end
+  in
+  (* Applies the garbage collector settings given with -gc_tune, e.g. "minor_heap_size=8M,space_overhead=200". Sizes are
+     in words and may have a k, M or G suffix, as in OCAMLRUNPARAM. *)
+  let gc_tune settings =
+    String.split_on_char ',' settings |> List.iter begin fun setting ->
+      let (name, value) = Util.split_around_char setting '=' in
+      let value =
+        let n = String.length value in
+        let (digits, multiplier) =
+          match if n = 0 then ' ' else value.[n - 1] with
+            'k' -> (String.sub value 0 (n - 1), 1024)
+          | 'M' -> (String.sub value 0 (n - 1), 1024 * 1024)
+          | 'G' -> (String.sub value 0 (n - 1), 1024 * 1024 * 1024)
+          | _ -> (value, 1)
+        in
+        match int_of_string_opt digits with
+          Some v -> v * multiplier
+        | None -> raise (Arg.Bad (Printf.sprintf "-gc_tune: bad value '%s' for '%s'" value name))
+      in
+      match name with
+        "minor_heap_size" -> Gc.set {(Gc.get ()) with Gc.minor_heap_size = value}
+      | "space_overhead" -> Gc.set {(Gc.get ()) with Gc.space_overhead = value}
+      | _ -> raise (Arg.Bad (Printf.sprintf "-gc_tune: unknown setting '%s'; supported settings: minor_heap_size, space_overhead" name))
+    end
+  in
   let vroots = ref [Util.crt_vroot Util.default_bindir] in
   let add_vroot vroot =
     let (root, expansion) = Util.split_around_char vroot '=' in
@@ -383,12 +531,13 @@ let _ =
    * explanation or just " " to prevent this, or document why the
    * new option should be hidden.
    *)
-  let cla = [ "-stats", Set stats, " "
+  let cla = [ "-stats", Unit (fun () -> stats := true; Stats.start_alloc_attribution ()), "Print statistics, including garbage collector statistics per phase, allocation per subsystem and peak memory use."
             ; "-read_options_from_source_file", Set readOptionsFromSourceFile, "Retrieve disable_overflow_check, prover, target settings from first line of .c/.java file; syntax: //verifast_options{disable_overflow_check prover:z3v4.5 target:32bit}"
             ; "-json", Set json, "Report result as JSON"
             ; "-verbose", Set_int verbose, "-1 = file processing; 1 = statement executions; 2 = produce/consume steps; 4 = prover queries."
             ; "-disable_overflow_check", Set disable_overflow_check, " "
-            ; "-prover", String (fun str -> prover := str), "Set SMT prover (" ^ list_provers() ^ ")."
+            ; "-prover", String (fun str -> prover := str), "Set SMT prover (" ^ list_provers() ^ "). The external SMT-LIB provers run the command in the VERIFAST_SMTLIB_SOLVER environment variable instead of their solver, if it is set."
+            ; "-redux_max_axiom_instantiations", Arg.Int (fun n -> Redux.max_axiom_instantiations := n), "(Redux) Maximum number of live instances of each axiom; cuts off matching loops. 0 (default) means no limit."
             ; "-c", Set compileOnly, "Compile only, do not perform link checking."
             ; "-shared", Set isLibrary, "The file is a library (i.e. no main function required)."
             ; "-allow_assume", Set allowAssume, "Allow assume(expr) annotations."
@@ -427,35 +576,92 @@ let _ =
             ; "-javac", Unit (fun _ -> (useJavaFrontend := true; Java_frontend_bridge.load ())), " "
             ; "-enforce_annotations", Unit (fun _ -> (enforceAnnotations := true)), " "
             ; "-allow_undeclared_struct_types", Unit (fun () -> (allowUndeclaredStructTypes := true)), " "
+            ; "-list_theory", Set listTheory, "Assume the list.gh lemmas append_assoc, nth_append, nth_append_r and reverse_append as axioms, so that proofs need not call them."
+            ; "-bitvectors", Set bitvectors, "Also define the results of &, | and ^ on fixed-width integers through the prover's bit-vector theory (Z3 and SMT-LIB provers). Without -target, int, long and pointer-sized types have no fixed width and get no bit-vector facts. Can also be enabled per file with verifast_options{bitvectors}."
+            ; "-function_timeout", Float (fun t -> functionTimeout := Some t), "S  Give up on a function or method body after S seconds, report it together with its symbolic execution context, and continue with the next one."
+            ; "-function_memory_limit", Int (fun mb -> functionMemoryLimit := Some mb), "MB  Give up on a function or method body once the heap has grown by MB megabytes during its verification, report it, and continue with the next one."
+            ; "-gc_tune", String gc_tune, "minor_heap_size=WORDS,space_overhead=PERCENT  Tune the garbage collector for the workload. Sizes may have a k, M or G suffix."
+            ; "-function_max_depth", Int (fun n -> functionMaxDepth := Some n), "N  Give up on a function or method body once its symbolic execution is nested N contexts deep (blocks, branches, loop bodies and calls; the statements of a block do not nest), report it, and continue with the next one. Bounds the native stack and the memory held by the symbolic execution path."
+            ; "-join_branches", Set joinBranches, "Do not fork symbolic execution at an if statement whose branches only assign constants or local variables to local variables; instead, give each assigned variable a conditional value."
             ; "-target", String (fun s -> dataModel := Some (data_model_of_string s)), "Target platform of the program being verified. Determines the size of pointer and integer types. Supported targets: " ^ String.concat ", " (List.map fst data_models)
+            ; "-watch", Set watch, "Keep running and re-verify the source file, which must be the only one, whenever it or one of the files it includes changes."
+            ; "-server", Set server, "Answer JSON requests (one per line) on standard input; see vfconsole.ml for the supported methods."
+            ; "-qi_profile", String (fun f -> qiProfile := Some f; enable_qi_profiling ()), "Write a quantifier instantiation profile (instances, time and generation per axiom, and the statements that caused them) to the specified JSON file."
+            ; "-qi_profile_folded", String (fun f -> qiProfileFolded := Some f; enable_qi_profiling ()), "Write the quantifier instantiation cascades to the specified file in the folded stack format used by flame graph tools."
+            ; "-trace", String Tracelog.start, "Stream the execution tree, the prover calls and the context of each error to the specified binary trace log instead of keeping the execution tree in memory. Use vftrace to view the log."
+            ; "-profile", String (fun f -> profile := Some f; enable_profiling ()), "Write a verification profile (wall time, prover time, prover queries, branches and chunk matching attempts per source line) to the specified JSON file."
+            ; "-profile_folded", String (fun f -> profileFolded := Some f; enable_profiling ()), "Write the verification time per stack of statements being executed to the specified file in the folded stack format used by flame graph tools."
             ]
   in
+  let get_options () = {
+    option_verbose = !verbose;
+    option_disable_overflow_check = !disable_overflow_check;
+    option_allow_should_fail = !allowShouldFail;
+    option_emit_manifest = !emitManifest;
+    option_check_manifest = !checkManifest;
+    option_vroots = !vroots;
+    option_allow_assume = !allowAssume;
+    option_simplify_terms = !simplifyTerms;
+    option_runtime = !runtime;
+    option_provides = !provides;
+    option_keep_provide_files = !keepProvideFiles;
+    option_include_paths = List.map (Util.replace_vroot !vroots) !include_paths;
+    option_define_macros = !define_macros;
+    option_safe_mode = !safe_mode;
+    option_header_whitelist = !header_whitelist;
+    option_use_java_frontend = !useJavaFrontend;
+    option_enforce_annotations = !enforceAnnotations;
+    option_allow_undeclared_struct_types = !allowUndeclaredStructTypes;
+    option_data_model = !dataModel;
+    option_report_skipped_stmts = false;
+    option_verify_only = [];
+    option_list_theory = !listTheory;
+    option_bitvectors = !bitvectors;
+    option_join_branches = !joinBranches;
+    option_function_timeout = !functionTimeout;
+    option_function_memory_limit = !functionMemoryLimit;
+    option_function_max_depth = !functionMaxDepth;
+  }
+  in
+  (* Re-runs [verify_once] whenever the contents of a file that took part in the previous run change.
+     The standard library offers no portable file change notification, so we poll modification times
+     and compare digests to ignore changes that leave the contents intact. *)
+  let watch_file verify_once path =
+    let watched_files = Hashtbl.create 50 in
+    let snapshot f = Hashtbl.fold (fun p () acc -> (p, f p)::acc) watched_files [] |> List.sort compare in
+    let mtime p = try (Unix.stat p).Unix.st_mtime with Unix.Unix_error _ -> 0.0 in
+    let digest p = try Digest.file p with Sys_error _ -> "" in
+    let run () =
+      Hashtbl.reset watched_files;
+      Hashtbl.replace watched_files path ();
+      Proverapi.qi_clear ();
+      begin try
+        verify_once (Some watched_files)
+      with
+        WatchedRunFailed -> ()
+      | e -> print_endline ("Verification failed with exception " ^ Printexc.to_string e)
+      end;
+      write_qi_profile ();
+      if not !json then print_endline "Watching for changes...";
+      (snapshot mtime, snapshot digest)
+    in
+    let rec wait (mtimes, digests) =
+      ignore (Unix.select [] [] [] 0.5);
+      let mtimes' = snapshot mtime in
+      if mtimes' = mtimes then wait (mtimes, digests) else
+      let digests' = snapshot digest in
+      if digests' = digests then wait (mtimes', digests) else begin
+        if not !json then print_endline path;
+        wait (run ())
+      end
+    in
+    wait (run ())
+  in
   let process_file filename =
     if List.exists (Filename.check_suffix filename) [ ".c"; ".cpp"; ".java"; ".scala"; ".jarsrc"; ".javaspec" ]
     then
       begin
-        let options = {
-          option_verbose = !verbose;
-          option_disable_overflow_check = !disable_overflow_check;
-          option_allow_should_fail = !allowShouldFail;
-          option_emit_manifest = !emitManifest;
-          option_check_manifest = !checkManifest;
-          option_vroots = !vroots;
-          option_allow_assume = !allowAssume;
-          option_simplify_terms = !simplifyTerms;
-          option_runtime = !runtime;
-          option_provides = !provides;
-          option_keep_provide_files = !keepProvideFiles;
-          option_include_paths = List.map (Util.replace_vroot !vroots) !include_paths;
-          option_define_macros = !define_macros;
-          option_safe_mode = !safe_mode;
-          option_header_whitelist = !header_whitelist;
-          option_use_java_frontend = !useJavaFrontend;
-          option_enforce_annotations = !enforceAnnotations;
-          option_allow_undeclared_struct_types = !allowUndeclaredStructTypes;
-          option_data_model = !dataModel;
-          option_report_skipped_stmts = false;
-        } in
+        let options = get_options () in
         if not !json then print_endline filename;
         let emitter_callback (packages : package list) =
           match !outputSExpressions with
@@ -464,7 +670,10 @@ let _ =
               SExpressionEmitter.emit target_file packages          
             | None             -> ()
         in
-        verify ~emitter_callback:emitter_callback !stats options !prover filename !emitHighlightedSourceFiles !dumpPerLineStmtExecCounts !allowDeadCode !json !readOptionsFromSourceFile;
+        let verify_once watched_files =
+          verify ~emitter_callback:emitter_callback ?watched_files !stats options !prover filename !emitHighlightedSourceFiles !dumpPerLineStmtExecCounts !allowDeadCode !json !readOptionsFromSourceFile
+        in
+        if !watch then push (verify_once, filename) watchedSourceFiles else verify_once None;
         allModules := ((Filename.chop_extension filename) ^ ".vfmanifest")::!allModules
       end
     else if Filename.check_suffix filename ".o" then
@@ -486,6 +695,79 @@ let _ =
         exit 1
       end
   in
+  (* Verification server. Each line of standard input is a request
+       {"id": ..., "method": M, "params": {...}}
+     answered by one line {"id": ..., "result": R} or {"id": ..., "error": msg} on standard output, where M is one of
+     the methods below. R is as reported by -json, except that a FunctionBudgetsExceeded result lists the functions that
+     exceeded their budget as its third element.
+       "verify" {"path"}: verify the file; R is the result object also reported by -json
+       "verifyFunction" {"path", "function"}: verify only the body of the given function
+       "symbolicState" {"path", "line"}: run to the given line; if reached, R is a SymbolicExecutionError whose
+         context stack describes the symbolic states at that line
+       "shutdown" {}: exit
+     The file is re-read on every request, so "verify" also serves to re-check a file after an edit. Any other output,
+     such as -verbose traces, goes to standard error. *)
+  let serve () =
+    let responses = Unix.out_channel_of_descr (Unix.dup Unix.stdout) in
+    flush stdout;
+    Unix.dup2 Unix.stderr Unix.stdout;
+    let run options path breakpoint =
+      try
+        let prover, options =
+          if !readOptionsFromSourceFile then merge_options_from_source_file !prover options path else !prover, options
+        in
+        let budgetsExceeded = ref [] in
+        let reportFunctionBudgetExceeded l g ctxts msg = push (l, g, ctxts, msg) budgetsExceeded in
+        let callbacks = {Verifast1.noop_callbacks with reportFunctionBudgetExceeded} in
+        let stats = verify_program prover options path callbacks breakpoint None in
+        if !budgetsExceeded <> [] then
+          A [S "FunctionBudgetsExceeded"; S (Printf.sprintf "%d function(s) exceeded their budget" (List.length !budgetsExceeded));
+             A (List.rev !budgetsExceeded |> List.map json_of_function_budget_exceeded)]
+        else
+        A [S "success"; S ("0 errors found (" ^ string_of_int stats#getStmtExec ^ " statements verified)")]
+      with
+        PreprocessorDivergence (l, msg) -> A [S "StaticError"; json_of_loc (Lexed l); S msg]
+      | ParseException (l, msg) -> A [S "StaticError"; json_of_loc l; S ("Parse error" ^ (if msg = "" then "." else ": " ^ msg))]
+      | CompilationError msg -> A [S "CompilationError"; S msg]
+      | StaticError (l, msg, url) -> A [S "StaticError"; json_of_loc l; S msg]
+      | SymbolicExecutionError (ctxts, l, msg, url) ->
+        A [S "SymbolicExecutionError"; A (List.map json_of_ctxt ctxts); json_of_loc l; S msg; match url with None -> Null | Some s -> S s]
+    in
+    let field name json = match json with O props when List.mem_assoc name props -> List.assoc name props | _ -> Null in
+    let handle request =
+      let params = field "params" request in
+      let string_param name = match field name params with S s -> s | _ -> failwith ("Missing string parameter '" ^ name ^ "'") in
+      let int_param name = match field name params with I n -> n | _ -> failwith ("Missing integer parameter '" ^ name ^ "'") in
+      let options = get_options () in
+      match field "method" request with
+        S "verify" -> run options (string_param "path") None
+      | S "verifyFunction" -> run {options with option_verify_only = [string_param "function"]} (string_param "path") None
+      | S "symbolicState" -> let path = string_param "path" in run options path (Some (path, int_param "line"))
+      | S "shutdown" -> Java_frontend_bridge.unload (); exit 0
+      | S m -> failwith ("Unknown method '" ^ m ^ "'")
+      | _ -> failwith "Missing method"
+    in
+    let rec loop () =
+      match try Some (input_line stdin) with End_of_file -> None with
+        None -> ()
+      | Some line ->
+        let response =
+          try
+            let request = parse_json line in
+            let id = field "id" request in
+            begin try
+              O ["id", id; "result", handle request]
+            with
+              Failure msg -> O ["id", id; "error", S msg]
+            | e -> O ["id", id; "error", S (Printexc.to_string e)]
+            end
+          with JsonException (offset, msg) -> O ["id", Null; "error", S (Printf.sprintf "Malformed request at offset %d: %s" offset msg)]
+        in
+        output_json_endline responses response;
+        loop ()
+    in
+    loop ()
+  in
   let usage_string =
     Verifast.banner ()
     ^ "\nUsage: verifast [options] {sourcefile|objectfile}\n"
@@ -500,6 +782,12 @@ let _ =
       result
     in
     parse cla process_file usage_string;
+    begin match !watchedSourceFiles with
+      [] -> ()
+    | [(verify_once, filename)] -> watch_file verify_once filename
+    | _ -> print_endline "Option -watch takes a single source file."; exit 1
+    end;
+    if !server then serve () else
     if not !compileOnly then
       begin
         try
@@ -1476,6 +1476,13 @@ let show_ide initialPath prover codeFont traceFont runtime layout javaFrontend e
                 option_safe_mode = false;
                 option_header_whitelist = [];
                 option_report_skipped_stmts = false;
+                option_verify_only = [];
+                option_list_theory = false;
+                option_bitvectors = false;
+                option_join_branches = false;
+                option_function_timeout = None;
+                option_function_memory_limit = None;
+                option_function_max_depth = None;
               }
               in
               let reportExecutionForest =
@@ -1508,7 +1515,7 @@ let show_ide initialPath prover codeFont traceFont runtime layout javaFrontend e
                 | _ -> false
               in
               let prover, options = merge_options_from_source_file prover options path in
-              let stats = verify_program prover options path {reportRange; reportUseSite; reportStmt; reportStmtExec; reportExecutionForest; reportDirective} breakpoint targetPath in
+              let stats = verify_program prover options path {reportRange; reportUseSite; reportStmt; reportStmtExec; reportExecutionForest; reportDirective; reportFunctionBudgetExceeded = (fun _ _ _ _ -> ())} breakpoint targetPath in
               begin
                 let _, tab = get_tab_for_path path in
                 let column = tab#stmtExecCountsColumn in
@@ -0,0 +1,111 @@
+(* vftrace: reads a trace log written by vfconsole -trace and prints the errors it records together with their symbolic
+   execution context, or rebuilds the execution tree, as text or as JSON. *)
+
+open Json
+open Tracelog
+
+let (|>) x f = f x
+
+let show_tree = ref false
+let show_prover_calls = ref false
+let show_json = ref false
+let trace_filename = ref None
+
+let string_of_srcpos (path, line, col) = Printf.sprintf "%s(%d,%d)" path line col
+
+let string_of_context c =
+  match c with
+    CtxtAssuming t -> "Assuming " ^ t
+  | CtxtExecuting (h, env, pos, msg) ->
+    "Heap: " ^ String.concat " * " h ^ "\nEnv: " ^ String.concat "; " (List.map (fun (x, v) -> x ^ " = " ^ v) env) ^ "\n" ^ string_of_srcpos pos ^ ": " ^ msg
+  | CtxtPushSubcontext -> "Entering subcontext"
+  | CtxtPopSubcontext -> "Leaving subcontext"
+  | CtxtBranching left -> if left then "Executing first branch" else "Executing second branch"
+
+type node = {
+  label: srcpos * string;
+  mutable children: child list (* In reverse order *)
+}
+and child = ExecChild of int | SuccessLeaf | ErrorLeaf of srcpos * string | ProverLeaf of prover_call * string * string
+
+let () =
+  let cla = [
+    "-tree", Arg.Set show_tree, "Print the execution tree instead of only the errors";
+    "-prover", Arg.Set show_prover_calls, "Include the prover calls in the execution tree";
+    "-json", Arg.Set show_json, "Print the execution tree as JSON";
+  ] in
+  let usage = "Usage: vftrace [options] trace.bin\n" in
+  Arg.parse cla (fun s -> trace_filename := Some s) usage;
+  let filename = match !trace_filename with Some f -> f | None -> Arg.usage cla usage; exit 2 in
+  let build_tree = !show_tree || !show_json in
+  let nodes: (int, node) Hashtbl.t = Hashtbl.create 10000 in
+  Hashtbl.add nodes 0 {label = (("", 0, 0), "root"); children = []};
+  let add_child parent child =
+    match Hashtbl.find_opt nodes parent with
+      Some node -> node.children <- child::node.children
+    | None -> ()
+  in
+  let nodeCount = ref 0 in
+  let successCount = ref 0 in
+  let errorCount = ref 0 in
+  let proverCallCount = ref 0 in
+  let print_error pos msg ctxts =
+    Printf.printf "Error: %s: %s\n" (string_of_srcpos pos) msg;
+    ctxts |> List.rev |> List.iter (fun c -> print_endline ("  " ^ String.concat "\n  " (String.split_on_char '\n' (string_of_context c))));
+    print_newline ()
+  in
+  let truncated =
+    try
+      iter_events filename begin function
+        ExecNode (id, parent, pos, msg) ->
+        incr nodeCount;
+        if build_tree then begin
+          Hashtbl.add nodes id {label = (pos, msg); children = []};
+          add_child parent (ExecChild id)
+        end
+      | SuccessNode parent ->
+        incr successCount;
+        if build_tree then add_child parent SuccessLeaf
+      | ErrorNode (parent, pos, msg, ctxts) ->
+        incr errorCount;
+        if build_tree then add_child parent (ErrorLeaf (pos, msg)) else print_error pos msg ctxts
+      | ProverCallNode (parent, kind, term, result) ->
+        incr proverCallCount;
+        if build_tree && !show_prover_calls then add_child parent (ProverLeaf (kind, term, result))
+      end;
+      None
+    with Corrupt_trace msg -> Some msg
+  in
+  if !show_json then begin
+    let rec json_of_child child =
+      match child with
+        ExecChild id ->
+        let {label = (pos, msg); children} = Hashtbl.find nodes id in
+        O ["kind", S "exec"; "loc", S (string_of_srcpos pos); "message", S msg; "children", A (List.rev_map json_of_child children)]
+      | SuccessLeaf -> O ["kind", S "success"]
+      | ErrorLeaf (pos, msg) -> O ["kind", S "error"; "loc", S (string_of_srcpos pos); "message", S msg]
+      | ProverLeaf (kind, term, result) -> O ["kind", S (match kind with AssumeCall -> "assume" | QueryCall -> "query"); "term", S term; "result", S result]
+    in
+    let buf = Buffer.create 4096 in
+    buffer_add_json_pp buf 2 (A (List.rev_map json_of_child (Hashtbl.find nodes 0).children));
+    Buffer.add_char buf '\n';
+    Buffer.output_buffer stdout buf
+  end else begin
+    if !show_tree then begin
+      let rec print_child indent child =
+        match child with
+          ExecChild id ->
+          let {label = (pos, msg); children} = Hashtbl.find nodes id in
+          Printf.printf "%s%s: %s\n" indent (string_of_srcpos pos) msg;
+          List.iter (print_child (indent ^ "  ")) (List.rev children)
+        | SuccessLeaf -> Printf.printf "%sSuccess\n" indent
+        | ErrorLeaf (pos, msg) -> Printf.printf "%sError: %s: %s\n" indent (string_of_srcpos pos) msg
+        | ProverLeaf (kind, term, result) -> Printf.printf "%s[%s %s: %s]\n" indent (match kind with AssumeCall -> "assume" | QueryCall -> "query") term result
+      in
+      List.iter (print_child "") (List.rev (Hashtbl.find nodes 0).children)
+    end;
+    Printf.printf "%d execution steps, %d successful paths, %d errors, %d prover calls\n" !nodeCount !successCount !errorCount !proverCallCount
+  end;
+  match truncated with
+    None -> ()
+  | Some msg -> Printf.eprintf "Warning: %s; the events before the damage are shown.\n" msg; exit 1
@@ -67,12 +67,19 @@ module Z3 = struct
     let mk_forall ctxt weight pats sorts names body =
       if Array.length names <> Array.length sorts then failwith "Internal error";
       Z3native.mk_forall ctxt weight (Array.length pats) (Array.to_list pats) (Array.length sorts) (Array.to_list sorts) (Array.to_list names) body
+    (* Like mk_forall, but names the quantifier so that Z3's quantifier instantiation profile can refer to it. *)
+    let mk_named_forall ctxt qid weight pats sorts names body =
+      if Array.length names <> Array.length sorts then failwith "Internal error";
+      Z3native.mk_quantifier_ex ctxt true weight (Z3native.mk_string_symbol ctxt qid) (Z3native.mk_string_symbol ctxt "")
+        (Array.length pats) (Array.to_list pats) 0 [] (Array.length sorts) (Array.to_list sorts) (Array.to_list names) body
 
 end
 
 class z3_context () =
   let () = Z3native.global_param_set "smt.auto_config" "false" in
   let () = Z3native.global_param_set "smt.mbqi" "false" in
+  (* Makes Z3 print the number of instances of each quantifier when the solver is destroyed. *)
+  let () = if !qi_profiling then Z3native.global_param_set "smt.qi.profile" "true" in
   let cfg = Z3native.mk_config () in
   let () = Z3native.set_param_value cfg "auto_config" "false" in
   let () = Z3native.set_param_value cfg "model" "false" in
@@ -99,10 +106,63 @@ class z3_context () =
   let ctor_counter = ref 0 in
   let get_ctor_tag () = let k = !ctor_counter in ctor_counter := k + 1; k in
   let mk_unary_app f t = Z3.mk_app ctxt f [| t |] in
+  (* Caches of function declarations and frequently built terms. Z3 identifies function declarations by name and
+     signature and hash-conses terms, so these stay valid across push/pop scopes, for the lifetime of the context. *)
+  let cache_hits = ref 0 in
+  let cache_misses = ref 0 in
+  let cache_limit = 100000 in
+  let cached tbl key mk =
+    try
+      let v = Hashtbl.find tbl key in
+      incr cache_hits;
+      v
+    with Not_found ->
+      incr cache_misses;
+      let v = mk () in
+      if Hashtbl.length tbl >= cache_limit then Hashtbl.reset tbl;
+      Hashtbl.add tbl key v;
+      v
+  in
+  (* VeriFast only uses the four sorts below, so they can be keyed without calling into Z3. *)
+  let sort_key s =
+    if s == bool_type then 0 else if s == int_type then 1 else if s == real_type then 2 else if s == inductive_type then 3 else -1
+  in
+  let func_decls = Hashtbl.create 1000 in
+  let mk_func_decl name tps range =
+    let mk () = Z3.mk_func_decl ctxt (Z3native.mk_string_symbol ctxt name) tps range in
+    let key = (name, Array.to_list (Array.map sort_key tps), sort_key range) in
+    if sort_key range < 0 || Array.exists (fun tp -> sort_key tp < 0) tps then mk () else cached func_decls key mk
+  in
+  (* Keyed by Z3's AST id: the cached application keeps its argument alive, so the id is not reused. *)
+  let mk_cached_unary_app f =
+    let tbl = Hashtbl.create 1000 in
+    fun t -> cached tbl (Z3native.get_ast_id ctxt t) (fun () -> mk_unary_app f t)
+  in
+  let intlits = Hashtbl.create 1000 in
+  let reallits = Hashtbl.create 100 in
   let solver = Z3native.mk_simple_solver ctxt in
+  (* The Z3 API does not report instances per quantifier, so when profiling, the instances performed by each check are
+     attributed to the statement being verified as a whole. *)
+  let quant_instantiations = ref 0 in
+  let profile_check () =
+    let stats = Z3native.solver_get_statistics ctxt solver in
+    let rec find i =
+      if i = Z3native.stats_size ctxt stats then 0 else
+      if Z3native.stats_get_key ctxt stats i = "quant instantiations" && Z3native.stats_is_uint ctxt stats i then
+        Z3native.stats_get_uint_value ctxt stats i
+      else
+        find (i + 1)
+    in
+    let count = find 0 in
+    let delta = if count >= !quant_instantiations then count - !quant_instantiations else count in
+    quant_instantiations := count;
+    if delta > 0 then qi_record_instances "(Z3 quantifiers)" delta ["(Z3 quantifiers)"]
+  in
   let assert_term t =
     Z3native.solver_assert ctxt solver t;
-    match Z3enums.lbool_of_int (Z3native.solver_check ctxt solver) with
+    let result = Z3native.solver_check ctxt solver in
+    if !qi_profiling then profile_check ();
+    match Z3enums.lbool_of_int result with
       Z3enums.L_FALSE -> Unsat
     | Z3enums.L_UNDEF -> Unknown
     | Z3enums.L_TRUE -> Unknown
@@ -134,7 +194,13 @@ class z3_context () =
   let () = assume_is_inverse boxed_real unboxed_real inductive_type in
   let div = Z3.mk_func_decl ctxt (Z3native.mk_string_symbol ctxt "div") [| int_type; int_type |] int_type in
   let modulo = Z3.mk_func_decl ctxt (Z3native.mk_string_symbol ctxt "mod") [| int_type; int_type |] int_type in
-  object
+  let mk_boxed_int = mk_cached_unary_app boxed_int in
+  let mk_unboxed_int = mk_cached_unary_app unboxed_int in
+  let mk_boxed_bool = mk_cached_unary_app boxed_bool in
+  let mk_unboxed_bool = mk_cached_unary_app unboxed_bool in
+  let mk_boxed_real = mk_cached_unary_app boxed_real in
+  let mk_unboxed_real = mk_cached_unary_app unboxed_real in
+  object (self)
     val mutable verbosity = 0
     val mutable pushlevel = 0
     method set_verbosity v = verbosity <- v
@@ -142,15 +208,15 @@ class z3_context () =
     method type_int = int_type
     method type_real = real_type
     method type_inductive = inductive_type
-    method mk_boxed_int t = Z3.mk_app ctxt boxed_int [| t |]
-    method mk_unboxed_int t = Z3.mk_app ctxt unboxed_int [| t |]
-    method mk_boxed_bool t = Z3.mk_app ctxt boxed_bool [| t |]
-    method mk_unboxed_bool t = Z3.mk_app ctxt unboxed_bool [| t |]
-    method mk_boxed_real t = Z3.mk_app ctxt boxed_real [| t |]
-    method mk_unboxed_real t = Z3.mk_app ctxt unboxed_real [| t |]
+    method mk_boxed_int t = mk_boxed_int t
+    method mk_unboxed_int t = mk_unboxed_int t
+    method mk_boxed_bool t = mk_boxed_bool t
+    method mk_unboxed_bool t = mk_unboxed_bool t
+    method mk_boxed_real t = mk_boxed_real t
+    method mk_unboxed_real t = mk_unboxed_real t
     method mk_symbol name domain range kind =
       let tps = Array.of_list domain in
-      let c = Z3.mk_func_decl ctxt (Z3native.mk_string_symbol ctxt name) tps range in
+      let c = mk_func_decl name tps range in
       begin
         match kind with
           Ctor (CtorByOrdinal (subtype, _)) ->
@@ -225,10 +291,12 @@ class z3_context () =
       if verbosity >= 100 then printff "Z3#mk_eq %s %s\n" (Z3native.ast_to_string ctxt t1) (Z3native.ast_to_string ctxt t2);
       Z3native.mk_eq ctxt t1 t2
     method mk_intlit n =
-      if n land (lnot 0x7fffffff) = 0 then (* See issue #138 *)
-        Z3native.mk_int ctxt n int_type
-      else
-        Z3native.mk_numeral ctxt (string_of_int n) int_type
+      cached intlits n begin fun () ->
+        if n land (lnot 0x7fffffff) = 0 then (* See issue #138 *)
+          Z3native.mk_int ctxt n int_type
+        else
+          Z3native.mk_numeral ctxt (string_of_int n) int_type
+      end
     method mk_intlit_of_string s = Z3native.mk_numeral ctxt s int_type
     method mk_add t1 t2 = Z3native.mk_add ctxt 2 [t1; t2]
     method mk_sub t1 t2 = Z3native.mk_sub ctxt 2 [t1; t2]
@@ -237,7 +305,7 @@ class z3_context () =
     method mk_mod t1 t2 = Z3.mk_app ctxt modulo [| t1; t2 |]
     method mk_lt t1 t2 = Z3native.mk_lt ctxt t1 t2
     method mk_le t1 t2 = Z3native.mk_le ctxt t1 t2
-    method mk_reallit n = Z3native.mk_int ctxt n real_type
+    method mk_reallit n = cached reallits n (fun () -> Z3native.mk_int ctxt n real_type)
     method mk_reallit_of_num n = Z3native.mk_numeral ctxt (string_of_num n) real_type
     method mk_real_add t1 t2 = Z3native.mk_add ctxt 2 [t1; t2]
     method mk_real_sub t1 t2 = Z3native.mk_sub ctxt 2 [t1; t2]
@@ -256,6 +324,11 @@ class z3_context () =
       let result = query t in
       if verbosity >= 1 then begin let t1 = Perf.time() in Printf.printf "%10.6fs: Z3 query %s returns %s: %.6f seconds\n" t0 (Z3native.ast_to_string ctxt t) (if result then "true" else "false") (t1 -. t0) end;
       result
+    method query_all ts = List.for_all (fun t -> self#query (t ())) ts
+    method mk_bitwise op signed width t1 t2 =
+      let mk_bvop = match op with BvAnd -> Z3native.mk_bvand | BvOr -> Z3native.mk_bvor | BvXor -> Z3native.mk_bvxor in
+      let bv t = Z3native.mk_int2bv ctxt width t in
+      Some (Z3native.mk_bv2int ctxt (mk_bvop ctxt (bv t1) (bv t2)) signed)
     method assume t =
       (* printf "Z3prover.assume (%s)\n" (Z3native.ast_to_string ctxt t); *)
       let t0 = if verbosity >= 1 then Perf.time() else 0.0 in
@@ -271,7 +344,8 @@ class z3_context () =
       pushlevel <- pushlevel - 1;
       Z3native.solver_pop ctxt solver 1
     method perform_pending_splits (cont: Z3native.ast list -> bool) = cont []
-    method stats: string * (string * int64) list = "(no statistics for Z3)", []
+    method stats: string * (string * int64) list =
+      Printf.sprintf "Z3 declaration and term cache: %d hits, %d misses\n" !cache_hits !cache_misses, []
     method begin_formal = ()
     method end_formal = ()
     method mk_bound (i: int) (tp: Z3native.sort) = Z3native.mk_bound ctxt i tp
@@ -284,7 +358,7 @@ class z3_context () =
             [] -> [| |]
            | _ -> [|(Z3.mk_pattern ctxt (Array.of_list triggers))|]
         ) in
-        let quant = (Z3.mk_forall ctxt 0 pats (Array.of_list tps) (Array.init (List.length tps) (Z3native.mk_int_symbol ctxt)) (body)) in
+        let quant = (Z3.mk_named_forall ctxt description 0 pats (Array.of_list tps) (Array.init (List.length tps) (Z3native.mk_int_symbol ctxt)) (body)) in
         (* printf "%s\n" (string_of_sexpr (simplify (parse_sexpr (Z3native.ast_to_string ctxt quant)))); *)
         Z3native.solver_assert ctxt solver quant
    method simplify (t: Z3native.ast): Z3native.ast option = Some(Z3native.simplify ctxt t)
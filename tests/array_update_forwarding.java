@@ -0,0 +1,35 @@
+// Reading an array element back after writes to an array slice (see mk_array_nth).
+
+class ArrayUpdateForwarding {
+
+  static void differentIndices(int[] xs, int i, int j)
+    //@ requires xs[0..10] |-> ?vs &*& 0 <= i &*& i < 10 &*& 0 <= j &*& j < 10 &*& i != j;
+    //@ ensures xs[0..10] |-> update(j, 2, update(i, 1, vs));
+  {
+    xs[i] = 1;
+    xs[j] = 2;
+    int x = xs[i];
+    //@ assert x == 1;
+  }
+
+  static void sameIndex(int[] xs, int i, int j)
+    //@ requires xs[0..10] |-> ?vs &*& 0 <= i &*& i < 10 &*& 0 <= j &*& j < 10 &*& i == j;
+    //@ ensures xs[0..10] |-> update(j, 2, update(i, 1, vs));
+  {
+    xs[i] = 1;
+    xs[j] = 2;
+    int x = xs[i];
+    //@ assert x == 2;
+  }
+
+  static void unknownIndices(int[] xs, int i, int j)
+    //@ requires xs[0..10] |-> ?vs &*& 0 <= i &*& i < 10 &*& 0 <= j &*& j < 10;
+    //@ ensures xs[0..10] |-> update(j, 2, update(i, 1, vs));
+  {
+    xs[i] = 1;
+    xs[j] = 2;
+    int x = xs[i];
+    //@ assert x == 1; //~ should_fail
+  }
+
+}
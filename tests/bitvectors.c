@@ -0,0 +1,17 @@
+//verifast_options{bitvectors prover:z3v4.5 target:32bit}
+
+// In bit-vector mode, Z3's bit-vector theory defines the results of &, | and ^ on fixed-width integers.
+// Only integer types whose width is fixed by the target get bit-vector facts, hence target:32bit.
+
+void test(unsigned int x, unsigned int y, int z)
+    //@ requires true;
+    //@ ensures true;
+{
+    unsigned int a = x | y;
+    unsigned int b = y | x;
+    //@ assert a == b;
+    unsigned int c = x ^ x;
+    //@ assert c == 0;
+    int d = z & -1;
+    //@ assert d == z;
+}
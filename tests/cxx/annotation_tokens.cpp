@@ -0,0 +1,25 @@
+// The AST exporter lexes most annotations itself (see ast_exporter/AnnotationTokenizer.cpp); the others, such as
+// annotations containing comments, are lexed by VeriFast's lexer. Both must yield the same tokens.
+
+//@ fixpoint int plus_hex(int x) { return x + 0x10; }
+
+/*@
+predicate cell(int *p, int v) =
+    *p |-> v &*& v != 'a' &*& 0 <= v;
+@*/
+
+void pretokenized(int *p)
+//@ requires cell(p, 1) &*& plus_hex(1) == 17;
+//@ ensures cell(p, 2);
+{
+    //@ open cell(p, 1);
+    *p = 2;
+    //@ close cell(p, 2);
+}
+
+void lexed(int *p)
+//@ requires cell(p, 1); // This comment makes the exporter leave the annotation to the lexer.
+//@ ensures cell(p, 1);
+{
+    //@ assert cell(p, 2); //~ should_fail
+}
@@ -0,0 +1,14 @@
+// A quantifier is instantiated for the terms that match its trigger, including the terms that exist before the
+// quantifier is assumed.
+
+//@ fixpoint bool p(int i);
+
+/*@
+
+lemma void instantiate_for_existing_term(int k, bool b)
+    requires b == p(k) &*& forall_(int i; p(i));
+    ensures b == true;
+{
+}
+
+@*/
@@ -0,0 +1,35 @@
+// Run by function_budget.sh with -function_max_depth 10. Each call of tick() in branchy() is on a branch of its own
+// and the rest of the body is verified inside that branch, so branchy() exceeds the depth budget. shallow() comes
+// after it and must still be verified.
+
+void tick(int *counter)
+    //@ requires *counter |-> ?n &*& n < 100;
+    //@ ensures *counter |-> n + 1;
+{
+    (*counter)++;
+}
+
+void branchy(int *counter, int a, int b, int c, int d, int e, int f, int g, int h, int i, int j, int k, int l)
+    //@ requires *counter |-> 0;
+    //@ ensures *counter |-> _;
+{
+    if (0 <= a) tick(counter);
+    if (0 <= b) tick(counter);
+    if (0 <= c) tick(counter);
+    if (0 <= d) tick(counter);
+    if (0 <= e) tick(counter);
+    if (0 <= f) tick(counter);
+    if (0 <= g) tick(counter);
+    if (0 <= h) tick(counter);
+    if (0 <= i) tick(counter);
+    if (0 <= j) tick(counter);
+    if (0 <= k) tick(counter);
+    if (0 <= l) tick(counter);
+}
+
+int shallow(int x)
+    //@ requires true;
+    //@ ensures true;
+{
+    return x + 1; //~ should_fail
+}
@@ -0,0 +1,18 @@
+#!/bin/sh
+# Checks that a function that exceeds its depth budget is reported together with its symbolic execution context, and
+# that verification continues with the next function: shallow() is not reported, and its should_fail directive is met
+# (otherwise the result would be a "No error found on line." static error).
+out=$(verifast -c -json -allow_should_fail -function_max_depth 10 function_budget.c)
+echo "$out"
+expect() {
+  case "$out" in
+    *"$1"*) ;;
+    *) echo "function_budget.sh: expected $1 in the output"; exit 1;;
+  esac
+}
+expect '"FunctionBudgetsExceeded"'
+expect '"branchy","Symbolic execution depth limit (10) exceeded",[['
+expect "\"Verifying function 'branchy'\""
+case "$out" in
+  *'"shallow"'*) echo "function_budget.sh: shallow() should not exceed its budget"; exit 1;;
+esac
@@ -0,0 +1,62 @@
+// Checks that applications of fixpoint functions to concrete arguments are evaluated correctly.
+
+/*@
+
+inductive tree = leaf | node(tree, int, tree);
+
+fixpoint int tree_size(tree t) {
+    switch (t) {
+        case leaf: return 0;
+        case node(l, v, r): return tree_size(l) + 1 + tree_size(r);
+    }
+}
+
+fixpoint bool tree_contains(tree t, int x) {
+    switch (t) {
+        case leaf: return false;
+        case node(l, v, r): return v == x || tree_contains(l, x) || tree_contains(r, x);
+    }
+}
+
+lemma void test_lists()
+    requires true;
+    ensures true;
+{
+    assert length(cons(1, cons(2, cons(3, nil)))) == 3;
+    assert mem(2, cons(1, cons(2, nil))) == true;
+    assert mem(5, cons(1, cons(2, nil))) == false;
+    assert nth(1, cons(10, cons(20, nil))) == 20;
+    assert length(append(cons(1, nil), cons(2, cons(3, nil)))) == 3;
+}
+
+lemma void test_trees()
+    requires true;
+    ensures true;
+{
+    tree t = node(node(leaf, 1, leaf), 2, node(leaf, 3, leaf));
+    assert tree_size(t) == 3;
+    assert tree_contains(t, 3) == true;
+    assert tree_contains(t, 4) == false;
+}
+
+// A nullary fixpoint written without parentheses is not a constructor; its value is left to the prover.
+fixpoint int k() { return 3; }
+
+fixpoint bool is_k(int x) { return x == k; }
+
+lemma void is_k_def(int x)
+    requires true;
+    ensures is_k(x) == (x == k);
+{
+}
+
+lemma void test_nullary_fixpoints()
+    requires true;
+    ensures true;
+{
+    assert is_k(3) == true;
+    is_k_def(3);
+    assert false; //~ should_fail
+}
+
+@*/
@@ -0,0 +1,68 @@
+// Checks that with -join_branches, if statements whose branches only assign constants or locals to locals are verified
+// without forking, and that other if statements are still verified as before. The test runs with -function_max_depth 10;
+// each forked if statement nests symbolic execution one level deeper, so flags() only stays within that bound if its
+// twelve if statements are merged.
+
+int clamp(int x, int lo, int hi)
+    //@ requires lo <= hi;
+    //@ ensures lo <= result &*& result <= hi &*& (lo <= x && x <= hi ? result == x : true);
+{
+    int r = x;
+    if (x < lo) r = lo;
+    if (hi < x) { r = hi; }
+    return r;
+}
+
+int sign(int x)
+    //@ requires true;
+    //@ ensures x < 0 ? result == -1 : x == 0 ? result == 0 : result == 1;
+{
+    int s = 0;
+    if (x < 0) {
+        s = -1;
+    } else if (x > 0) {
+        s = 1;
+    }
+    return s;
+}
+
+int max3(int a, int b, int c)
+    //@ requires true;
+    //@ ensures result >= a &*& result >= b &*& result >= c &*& (result == a || result == b || result == c);
+{
+    int m = a;
+    if (m < b) m = b;
+    if (m < c) m = c;
+    return m;
+}
+
+void swap_if_greater(int *p, int *q)
+    //@ requires *p |-> ?x &*& *q |-> ?y;
+    //@ ensures *p |-> ?x1 &*& *q |-> ?y1 &*& x1 <= y1;
+{
+    if (*q < *p) {
+        int tmp = *p;
+        *p = *q;
+        *q = tmp;
+    }
+}
+
+int flags(int a, int b, int c, int d, int e, int f, int g, int h, int i, int j, int k, int l)
+    //@ requires true;
+    //@ ensures result == (0 <= l ? 1 : 0);
+{
+    int r = 0;
+    if (0 <= a) r = 1; else r = 0;
+    if (0 <= b) r = 1; else r = 0;
+    if (0 <= c) r = 1; else r = 0;
+    if (0 <= d) r = 1; else r = 0;
+    if (0 <= e) r = 1; else r = 0;
+    if (0 <= f) r = 1; else r = 0;
+    if (0 <= g) r = 1; else r = 0;
+    if (0 <= h) r = 1; else r = 0;
+    if (0 <= i) r = 1; else r = 0;
+    if (0 <= j) r = 1; else r = 0;
+    if (0 <= k) r = 1; else r = 0;
+    if (0 <= l) r = 1; else r = 0;
+    return r;
+}
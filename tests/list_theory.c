@@ -0,0 +1,29 @@
+// Checks that with -list_theory, these list.gh lemmas need not be called.
+
+/*@
+
+lemma void test_append_assoc(list<int> xs, list<int> ys, list<int> zs)
+    requires true;
+    ensures append(append(xs, ys), zs) == append(xs, append(ys, zs));
+{
+}
+
+lemma void test_nth_append(list<int> xs, list<int> ys, int i)
+    requires 0 <= i &*& i < length(xs);
+    ensures nth(i, append(xs, ys)) == nth(i, xs);
+{
+}
+
+lemma void test_nth_append_r(list<int> xs, list<int> ys, int i)
+    requires length(xs) <= i &*& i < length(xs) + length(ys);
+    ensures nth(i, append(xs, ys)) == nth(i - length(xs), ys);
+{
+}
+
+lemma void test_reverse_append(list<int> xs, list<int> ys)
+    requires true;
+    ensures reverse(append(xs, ys)) == append(reverse(ys), reverse(xs));
+{
+}
+
+@*/
@@ -0,0 +1,33 @@
+// Overflow checks whose operands have known intervals are discharged without querying the prover. The intervals
+// narrowed by a condition hold only on the branch that assumes it.
+
+int add_chars(unsigned char a, unsigned char b)
+    //@ requires true;
+    //@ ensures result == a + b;
+{
+    return a + b;
+}
+
+int count(int n)
+    //@ requires true;
+    //@ ensures true;
+{
+    int s = 0;
+    for (int i = 0; i < 100; i++)
+        //@ invariant 0 <= i &*& i <= 100 &*& 0 <= s &*& s <= i;
+    {
+        s = i + 1;
+    }
+    return s;
+}
+
+void branches(int x)
+    //@ requires true;
+    //@ ensures true;
+{
+    if (x < 100) {
+        int y = x + 1;
+    } else {
+        int z = x + 1; //~ should_fail
+    }
+}
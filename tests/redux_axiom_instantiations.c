@@ -0,0 +1,23 @@
+// Run by redux_axiom_instantiations.sh with -redux_max_axiom_instantiations 100 -stats.
+
+//@ fixpoint int f(int x);
+
+/*@
+
+// f(a) and f(b) are in the same class when the quantifier is assumed, so its second instance is a duplicate of the
+// first and is skipped.
+lemma void duplicate_instance(int a, int b, int x, int y)
+    requires x == f(a) &*& y == f(b) &*& a == b &*& forall_(int i; 0 <= f(i));
+    ensures 0 <= y;
+{
+}
+
+// Each instance of the quantifier creates a term f(i + 1) that matches its trigger f(i) again. Without a limit on its
+// instances, Redux does not terminate.
+lemma void matching_loop(int k)
+    requires forall_(int i; f(i) == f(i + 1) + 1);
+    ensures f(k) == f(k + 2) + 2;
+{
+}
+
+@*/
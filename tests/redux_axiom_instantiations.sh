@@ -0,0 +1,14 @@
+#!/bin/sh
+# Verifies redux_axiom_instantiations.c, whose second quantifier forms a matching loop, with a limit on the instances of
+# each axiom, and checks that -stats reports both the duplicate instantiations and those cut off by the limit.
+out=$(verifast -c -prover redux -stats -redux_max_axiom_instantiations 100 redux_axiom_instantiations.c) || { echo "$out"; exit 1; }
+echo "$out"
+expect_skipped() {
+  case "$out" in
+    *"$1 = 0"*) echo "redux_axiom_instantiations.sh: expected $1 to be nonzero"; exit 1;;
+    *"$1 = "*) ;;
+    *) echo "redux_axiom_instantiations.sh: expected $1 in the output"; exit 1;;
+  esac
+}
+expect_skipped "axiom instantiations skipped as duplicates"
+expect_skipped "axiom instantiations skipped because of -redux_max_axiom_instantiations"
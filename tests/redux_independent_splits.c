@@ -0,0 +1,16 @@
+// The refutation of the postcondition's negation needs only the last of these case splits. Redux decides that split
+// by propagation instead of enumerating the combinations of the independent splits before it.
+
+/*@
+
+lemma void independent_splits(int a, int b, int c, int d, int e, int f, int g, int h, int i, int j, int k, int l, int x)
+    requires
+        (a == 0 || a == 1) &*& (b == 0 || b == 1) &*& (c == 0 || c == 1) &*& (d == 0 || d == 1) &*&
+        (e == 0 || e == 1) &*& (f == 0 || f == 1) &*& (g == 0 || g == 1) &*& (h == 0 || h == 1) &*&
+        (i == 0 || i == 1) &*& (j == 0 || j == 1) &*& (k == 0 || k == 1) &*& (l == 0 || l == 1) &*&
+        (x == 1 || x == 2);
+    ensures 1 <= x;
+{
+}
+
+@*/
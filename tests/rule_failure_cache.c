@@ -0,0 +1,36 @@
+// Each consumption of q(x) below first tries the auto-close rule for q via t and the auto lemma s_to_q, which both fail,
+// and then succeeds through r_to_q. The heap and the arguments are the same each time, so the second and third
+// attempts of the failing rules reuse their recorded failures.
+
+//@ predicate t(int x;);
+//@ predicate r(int x;) = t(x);
+//@ predicate s(int x;) = t(x);
+//@ predicate q(int x;) = t(x);
+
+/*@
+
+lemma_auto void r_to_q(int x)
+    requires r(x);
+    ensures q(x);
+{
+    open r(x);
+    close q(x);
+}
+
+lemma_auto void s_to_q(int x)
+    requires s(x);
+    ensures q(x);
+{
+    open s(x);
+    close q(x);
+}
+
+@*/
+
+void test(int x)
+    //@ requires r(x);
+    //@ ensures q(x);
+{
+    //@ assert q(x);
+    //@ assert q(x);
+}
@@ -0,0 +1,24 @@
+// Verified with -prover ext_z3 against smtlib_standin.sh, which cannot prove anything.
+
+//@ predicate in_range(int x;) = 0 <= x &*& x <= 10;
+
+void needs_no_query(int x)
+    //@ requires true;
+    //@ ensures true;
+{
+}
+
+// The leak check asks whether in_range(x) is empty through a single batch of queries (query_all), one for each
+// condition of its body.
+void needs_a_batch_of_queries(int x)
+    //@ requires in_range(x);
+    //@ ensures true;
+{
+} //~ should_fail
+
+void needs_a_query(int x)
+    //@ requires true;
+    //@ ensures true;
+{
+    //@ assert x == x; //~ should_fail
+}